@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <map>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+struct AdminRequest {
+    std::string method;
+    std::string path;
+    std::string query;  // after '?', undecoded
+
+    // Value of `name` in the query string ("a=1&b=2"), empty if absent.
+    std::string_view param(std::string_view name) const {
+        std::string_view rest = query;
+        while (!rest.empty()) {
+            std::string_view pair = rest.substr(0, rest.find('&'));
+            rest.remove_prefix(std::min(rest.size(), pair.size() + 1));
+            size_t equals = pair.find('=');
+            if (pair.substr(0, equals) == name) {
+                return equals == std::string_view::npos ? std::string_view() : pair.substr(equals + 1);
+            }
+        }
+        return {};
+    }
+};
+
+struct AdminResponse {
+    int status = 200;
+    std::string content_type = "text/plain";
+    std::string body;
+};
+
+// Tiny HTTP/1.1 endpoint for operators (reload, diagnostics). One thread
+// serves one request per connection, so handlers must be quick; they run on
+// that thread, never on a hot path. Not meant to face untrusted networks.
+class AdminServer {
+public:
+    using Handler = std::function<AdminResponse(const AdminRequest&)>;
+
+    AdminServer() = default;
+    ~AdminServer() { stop(); }
+
+    AdminServer(const AdminServer&) = delete;
+    AdminServer& operator=(const AdminServer&) = delete;
+
+    // Register before start(). `method` is e.g. "GET" or "POST".
+    void route(std::string method, std::string path, Handler handler) {
+        routes[std::move(path)] = Route{std::move(method), std::move(handler)};
+    }
+
+    bool start(const std::string& address, int port) {
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd < 0) {
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1 ||
+            bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd, 16) != 0) {
+            close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        running.store(true, std::memory_order_release);
+        server = std::thread([this] { run(); });
+        return true;
+    }
+
+    void stop() {
+        if (!server.joinable()) {
+            return;
+        }
+        running.store(false, std::memory_order_release);
+        server.join();
+        close(listen_fd);
+        listen_fd = -1;
+    }
+
+private:
+    struct Route {
+        std::string method;
+        Handler handler;
+    };
+
+    static const char* reason(int status) {
+        switch (status) {
+            case 200: return "OK";
+            case 400: return "Bad Request";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 409: return "Conflict";
+            case 503: return "Service Unavailable";
+            default: return "Internal Server Error";
+        }
+    }
+
+    void run() {
+        while (running.load(std::memory_order_acquire)) {
+            pollfd pfd{listen_fd, POLLIN, 0};
+            if (poll(&pfd, 1, 200) <= 0) {
+                continue;
+            }
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                serve(fd);
+                close(fd);
+            }
+        }
+    }
+
+    void serve(int fd) {
+        timeval timeout{1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string request;
+        char buffer[2048];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 16 * 1024) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                return;
+            }
+            request.append(buffer, static_cast<size_t>(n));
+        }
+
+        AdminResponse response;
+        AdminRequest parsed;
+        std::string_view line = std::string_view(request).substr(0, request.find("\r\n"));
+        size_t first_space = line.find(' ');
+        size_t second_space = line.find(' ', first_space + 1);
+        if (first_space == std::string_view::npos || second_space == std::string_view::npos) {
+            response = AdminResponse{400, "text/plain", "bad request\n"};
+        } else {
+            parsed.method = line.substr(0, first_space);
+            std::string_view target = line.substr(first_space + 1, second_space - first_space - 1);
+            size_t question = target.find('?');
+            parsed.path = target.substr(0, question);
+            if (question != std::string_view::npos) {
+                parsed.query = target.substr(question + 1);
+            }
+            auto it = routes.find(parsed.path);
+            if (it == routes.end()) {
+                response = AdminResponse{404, "text/plain", "not found\n"};
+            } else if (it->second.method != parsed.method) {
+                response = AdminResponse{405, "text/plain", "use " + it->second.method + "\n"};
+            } else {
+                try {
+                    response = it->second.handler(parsed);
+                } catch (const std::exception& e) {
+                    response = AdminResponse{500, "text/plain", std::string(e.what()) + "\n"};
+                }
+            }
+        }
+
+        std::string reply = "HTTP/1.1 " + std::to_string(response.status) + " " + reason(response.status) +
+                            "\r\nContent-Type: " + response.content_type +
+                            "\r\nContent-Length: " + std::to_string(response.body.size()) +
+                            "\r\nConnection: close\r\n\r\n" + response.body;
+        const char* data = reply.data();
+        size_t remaining = reply.size();
+        while (remaining > 0) {
+            ssize_t written = send(fd, data, remaining, MSG_NOSIGNAL);
+            if (written <= 0 && errno != EINTR) {
+                return;
+            }
+            if (written > 0) {
+                data += written;
+                remaining -= static_cast<size_t>(written);
+            }
+        }
+    }
+
+    std::map<std::string, Route, std::less<>> routes;
+    int listen_fd = -1;
+    std::thread server;
+    std::atomic<bool> running{false};
+};
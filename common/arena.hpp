@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+#include "buffer_pool.hpp"
+
+// Monotonic bump allocator for data that dies together (e.g. everything
+// decoded from one received batch of frames). deallocate() is a no-op and
+// reset() rewinds to the first chunk in O(1); chunks are kept across resets
+// so a warmed-up arena never goes back to the pool.
+class MonotonicArena : public std::pmr::memory_resource {
+public:
+    explicit MonotonicArena(size_t chunk_size = 64 * 1024) : chunk_size(chunk_size) {}
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    ~MonotonicArena() override {
+        Chunk* chunk = first;
+        while (chunk != nullptr) {
+            Chunk* next = chunk->next;
+            BufferPool::instance().release(reinterpret_cast<char*>(chunk), chunk->capacity);
+            chunk = next;
+        }
+    }
+
+    void reset() {
+        current = first;
+        cursor = first != nullptr ? first->begin() : nullptr;
+        limit = first != nullptr ? first->end() : nullptr;
+        used = 0;
+    }
+
+    size_t bytesUsed() const { return used; }
+    size_t highWaterMark() const { return high_water; }
+    size_t bytesReserved() const { return reserved; }
+
+private:
+    struct alignas(alignof(std::max_align_t)) Chunk {
+        Chunk* next;
+        size_t capacity;
+
+        char* begin() { return reinterpret_cast<char*>(this + 1); }
+        char* end() { return reinterpret_cast<char*>(this) + capacity; }
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        for (;;) {
+            if (cursor != nullptr) {
+                uintptr_t raw = reinterpret_cast<uintptr_t>(cursor);
+                uintptr_t aligned = (raw + alignment - 1) & ~(uintptr_t(alignment) - 1);
+                char* start = reinterpret_cast<char*>(aligned);
+                if (start + bytes <= limit) {
+                    cursor = start + bytes;
+                    used += bytes + (aligned - raw);
+                    high_water = std::max(high_water, used);
+                    return start;
+                }
+            }
+            advance(bytes + alignment);
+        }
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    // Moves to the next retained chunk, or appends a new one big enough.
+    void advance(size_t min_bytes) {
+        if (current != nullptr && current->next != nullptr &&
+            static_cast<size_t>(current->next->end() - current->next->begin()) >= min_bytes) {
+            current = current->next;
+        } else {
+            size_t capacity = 0;
+            size_t wanted = std::max(chunk_size, min_bytes + sizeof(Chunk));
+            Chunk* chunk = reinterpret_cast<Chunk*>(BufferPool::instance().allocate(wanted, capacity));
+            chunk->capacity = capacity;
+            reserved += capacity;
+            if (current == nullptr) {
+                chunk->next = first;
+                first = chunk;
+            } else {
+                chunk->next = current->next;
+                current->next = chunk;
+            }
+            current = chunk;
+        }
+        cursor = current->begin();
+        limit = current->end();
+    }
+
+    size_t chunk_size;
+    Chunk* first = nullptr;
+    Chunk* current = nullptr;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t used = 0;
+    size_t high_water = 0;
+    size_t reserved = 0;
+};
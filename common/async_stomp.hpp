@@ -0,0 +1,384 @@
+#pragma once
+
+#include <cerrno>
+#include <coroutine>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+#include "coro.hpp"
+#include "event_loop.hpp"
+#include "frame_capture.hpp"
+#include "ring_buffer.hpp"
+#include "stomp_frame.hpp"
+
+class AsyncStompClient;
+
+// Messages delivered to one SUBSCRIBE. `co_await sub.next()` yields the next
+// MESSAGE frame, or an empty StompMessage once the connection is gone.
+class Subscription {
+public:
+    explicit Subscription(std::string id) : subscription_id(std::move(id)) {}
+
+    const std::string& id() const { return subscription_id; }
+
+    struct NextAwaiter {
+        Subscription& sub;
+
+        bool await_ready() const noexcept { return !sub.pending.empty() || sub.closed; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept { sub.waiter = handle; }
+        StompMessage await_resume() {
+            StompMessage message;
+            if (!sub.pending.empty()) {
+                message = std::move(sub.pending.front());
+                sub.pending.pop_front();
+            }
+            return message;
+        }
+    };
+
+    NextAwaiter next() { return NextAwaiter{*this}; }
+
+private:
+    friend class AsyncStompClient;
+
+    std::string subscription_id;
+    std::deque<StompMessage> pending;
+    std::coroutine_handle<> waiter;
+    bool closed = false;
+};
+
+// Non-blocking STOMP client driven by an EventLoop. Every operation is a
+// Task to co_await, so producers and consumers read as straight-line code:
+//
+//   if (co_await client.connect()) {
+//       Subscription* sub = co_await client.subscribe("/queue/ProjectQueue");
+//       StompMessage message = co_await sub->next();
+//   }
+//
+// Writers are serialized so frames from concurrent coroutines never interleave.
+class AsyncStompClient {
+public:
+    AsyncStompClient(EventLoop& loop, std::string host, int port, size_t receive_buffer_size = 1024 * 1024)
+        : loop(loop), host(std::move(host)), port(port), recv_buffer_size(receive_buffer_size) {}
+
+    // Callers should co_await disconnect() first. If they did not, the read
+    // loop may still be suspended on the loop; unhook it before freeing it.
+    ~AsyncStompClient() {
+        if (reading) {
+            if (sockfd >= 0) {
+                loop.forget(sockfd, false);
+            }
+            loop.cancel(read_parked);
+        }
+        read_task = Task<void>();
+        closeSocket();
+    }
+
+    AsyncStompClient(const AsyncStompClient&) = delete;
+    AsyncStompClient& operator=(const AsyncStompClient&) = delete;
+
+    bool isConnected() const { return connected; }
+
+    // Records every frame written and read; set before connect().
+    void setCapture(FrameCapture* frame_capture) { capture = frame_capture; }
+
+    Task<bool> connect() {
+        if (!recv_buffer.valid() && !recv_buffer.allocate(recv_buffer_size, HugePageMode::Off)) {
+            std::cerr << "Error mapping receive ring buffer" << std::endl;
+            co_return false;
+        }
+        recv_buffer.clear();
+
+        struct hostent* host_entry = gethostbyname(host.c_str());
+        if (host_entry == nullptr) {
+            std::cerr << "Error resolving hostname: " << host << std::endl;
+            co_return false;
+        }
+        sockaddr_in server_addr{};
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        server_addr.sin_addr = *reinterpret_cast<in_addr*>(host_entry->h_addr_list[0]);
+
+        sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sockfd < 0) {
+            std::cerr << "Error creating socket" << std::endl;
+            co_return false;
+        }
+        if (::connect(sockfd, reinterpret_cast<sockaddr*>(&server_addr), sizeof(server_addr)) < 0) {
+            if (errno != EINPROGRESS) {
+                std::cerr << "Error connecting to ActiveMQ at " << host << ":" << port << std::endl;
+                closeSocket();
+                co_return false;
+            }
+            co_await loop.writable(sockfd);
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0) {
+                std::cerr << "Error connecting to ActiveMQ at " << host << ":" << port << ": " << strerror(error) << std::endl;
+                closeSocket();
+                co_return false;
+            }
+        }
+
+        PooledBuffer frame = StompFrameBuilder("CONNECT")
+            .header("accept-version", "1.0,1.1,1.2")
+            .header("host", host)
+            .header("heart-beat", "0,0")
+            .finish();
+        if (!co_await writeAll(frame)) {
+            closeSocket();
+            co_return false;
+        }
+
+        StompMessage response;
+        while (!takeFrame(response)) {
+            if (!co_await fill()) {
+                break;
+            }
+        }
+        if (response.command() != "CONNECTED") {
+            std::cerr << "Failed to receive CONNECTED frame" << std::endl;
+            closeSocket();
+            co_return false;
+        }
+        connected = true;
+        co_return true;
+    }
+
+    Task<bool> send(std::string_view destination, std::string_view body) {
+        PooledBuffer frame = StompFrameBuilder("SEND", body.size() + destination.size() + 128)
+            .header("destination", destination)
+            .header("content-type", "text/plain")
+            .header("content-length", body.size())
+            .header("sent-at-ns", realtimeNs())
+            .finish(body);
+        co_return co_await sendFrame(std::move(frame));
+    }
+
+    Task<bool> sendFrame(PooledBuffer frame) {
+        if (!connected) {
+            co_return false;
+        }
+        co_return co_await writeAll(frame);
+    }
+
+    // Returns nullptr if the SUBSCRIBE could not be written.
+    Task<Subscription*> subscribe(std::string destination) {
+        if (!connected) {
+            co_return nullptr;
+        }
+        Subscription& sub = subscriptions.emplace_back("sub-" + std::to_string(subscriptions.size() + 1));
+        // Only subscribers need MESSAGE frames routed; producers never read
+        if (!reading) {
+            reading = true;
+            read_task = readLoop();
+            loop.post(read_task.startHandle());
+        }
+        PooledBuffer frame = StompFrameBuilder("SUBSCRIBE")
+            .header("destination", destination)
+            .header("id", sub.id())
+            .header("ack", "auto")
+            .finish();
+        if (!co_await writeAll(frame)) {
+            co_return nullptr;
+        }
+        co_return &sub;
+    }
+
+    Task<void> disconnect() {
+        if (connected) {
+            PooledBuffer frame = StompFrameBuilder("DISCONNECT").finish();
+            co_await writeAll(frame);
+        }
+        // Wakes a parked read loop, which sees the closed socket and ends;
+        // it must finish before this client can be destroyed.
+        closeSocket();
+        if (reading) {
+            co_await ReadLoopDone{*this};
+        }
+        read_task = Task<void>();
+    }
+
+private:
+    // Single-threaded async mutex for the write side.
+    struct WriteLock {
+        AsyncStompClient& client;
+        bool await_ready() const noexcept { return !client.writing; }
+        void await_suspend(std::coroutine_handle<> handle) { client.write_waiters.push_back(handle); }
+        void await_resume() noexcept { client.writing = true; }
+    };
+
+    struct ReadLoopDone {
+        AsyncStompClient& client;
+        bool await_ready() const noexcept { return !client.reading; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept { client.read_done_waiter = handle; }
+        void await_resume() const noexcept {}
+    };
+
+    // loop.readable() that remembers the parked coroutine for the destructor.
+    struct ReadableAwaiter {
+        AsyncStompClient& client;
+        EventLoop::FdAwaiter inner;
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            client.read_parked = handle;
+            return inner.await_suspend(handle);
+        }
+        void await_resume() noexcept { client.read_parked = nullptr; }
+    };
+
+    void unlockWrites() {
+        writing = false;
+        if (!write_waiters.empty()) {
+            std::coroutine_handle<> next = write_waiters.front();
+            write_waiters.pop_front();
+            writing = true;
+            loop.post(next);
+        }
+    }
+
+    Task<bool> writeAll(const PooledBuffer& frame) {
+        if (writing) {
+            co_await WriteLock{*this};
+            // Ownership was handed over by unlockWrites()
+        } else {
+            writing = true;
+        }
+        if (capture != nullptr) {
+            capture->record(CaptureDirection::Sent, frame);
+        }
+        size_t offset = 0;
+        bool ok = true;
+        while (offset < frame.size()) {
+            ssize_t written = ::send(sockfd, frame.data() + offset, frame.size() - offset, MSG_NOSIGNAL);
+            if (written >= 0) {
+                offset += static_cast<size_t>(written);
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                co_await loop.writable(sockfd);
+            } else if (errno != EINTR) {
+                ok = false;
+                break;
+            }
+            if (sockfd < 0) {
+                ok = false;
+                break;
+            }
+        }
+        unlockWrites();
+        co_return ok;
+    }
+
+    // One read into the ring, waiting for readability as needed.
+    Task<bool> fill() {
+        for (;;) {
+            if (sockfd < 0 || recv_buffer.writable() == 0) {
+                co_return false;
+            }
+            ssize_t bytes_read = recv(sockfd, recv_buffer.writePtr(), recv_buffer.writable(), 0);
+            if (bytes_read > 0) {
+                recv_buffer.commit(static_cast<size_t>(bytes_read));
+                co_return true;
+            }
+            if (bytes_read == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                co_return false;
+            }
+            co_await ReadableAwaiter{*this, loop.readable(sockfd)};
+        }
+    }
+
+    bool takeFrame(StompMessage& out) {
+        StompFrameView frame;
+        ParseResult result = parseStompFrame(recv_buffer.readPtr(), recv_buffer.readable(), frame);
+        if (result.status != ParseStatus::Complete) {
+            recv_buffer.consume(result.consumed);
+            if (result.status == ParseStatus::Malformed) {
+                recv_buffer.clear();
+            }
+            return false;
+        }
+        if (capture != nullptr) {
+            capture->record(CaptureDirection::Received, frame);
+        }
+        size_t frame_start = frame.command.data() - recv_buffer.readPtr();
+        out.assign(recv_buffer.readPtr() + frame_start, result.consumed - frame_start);
+        recv_buffer.consume(result.consumed);
+        return true;
+    }
+
+    Subscription* findSubscription(std::string_view id) {
+        for (Subscription& sub : subscriptions) {
+            if (sub.id() == id) {
+                return &sub;
+            }
+        }
+        return nullptr;
+    }
+
+    // Routes MESSAGE frames to their subscription until the socket closes.
+    Task<void> readLoop() {
+        while (connected) {
+            StompMessage message;
+            while (takeFrame(message)) {
+                if (message.command() == "MESSAGE") {
+                    if (Subscription* sub = findSubscription(message.header("subscription"))) {
+                        sub->pending.push_back(std::move(message));
+                        if (sub->waiter) {
+                            loop.post(std::exchange(sub->waiter, nullptr));
+                        }
+                    }
+                } else if (message.command() == "ERROR") {
+                    std::cerr << "Broker sent ERROR: " << message.header("message") << std::endl;
+                }
+            }
+            if (!co_await fill()) {
+                break;
+            }
+        }
+        connected = false;
+        for (Subscription& sub : subscriptions) {
+            sub.closed = true;
+            if (sub.waiter) {
+                loop.post(std::exchange(sub.waiter, nullptr));
+            }
+        }
+        reading = false;
+        if (read_done_waiter) {
+            loop.post(std::exchange(read_done_waiter, nullptr));
+        }
+    }
+
+    void closeSocket() {
+        if (sockfd >= 0) {
+            loop.forget(sockfd);
+            close(sockfd);
+            sockfd = -1;
+        }
+        connected = false;
+    }
+
+    EventLoop& loop;
+    std::string host;
+    int port;
+    size_t recv_buffer_size;
+    int sockfd = -1;
+    bool connected = false;
+    MirroredRingBuffer recv_buffer;
+    std::deque<Subscription> subscriptions;
+    bool writing = false;
+    std::deque<std::coroutine_handle<>> write_waiters;
+    FrameCapture* capture = nullptr;
+    Task<void> read_task;  // started by the first subscribe()
+    bool reading = false;
+    std::coroutine_handle<> read_done_waiter;  // disconnect() waiting for the read loop
+    std::coroutine_handle<> read_parked;       // coroutine waiting in fill(), if any
+};
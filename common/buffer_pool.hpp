@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "huge_pages.hpp"
+
+constexpr size_t kCacheLineSize = 64;
+
+struct BufferPoolStats {
+    uint64_t hits = 0;              // served from a thread cache or the shared free lists
+    uint64_t misses = 0;            // had to carve fresh slab memory or fall back to the heap
+    uint64_t bytes_outstanding = 0; // capacity currently handed out to callers
+    uint64_t slab_bytes = 0;        // total memory reserved for slabs
+    uint64_t huge_slab_bytes = 0;   // part of slab_bytes backed by 2 MB pages
+
+    double hitRate() const {
+        uint64_t total = hits + misses;
+        return total == 0 ? 1.0 : static_cast<double>(hits) / static_cast<double>(total);
+    }
+};
+
+// Size-classed buffer pool. Every class is a power of two between 64 B and
+// 256 KiB, carved out of large cache-line aligned slabs that are never given
+// back to the OS. Slabs are 2 MB so they can be backed by huge pages (see
+// setHugePageMode). Each thread keeps a small free list per class so that the
+// steady-state allocate/release path touches no locks and performs no
+// malloc/free; the shared per-class lists are only hit on refill/overflow.
+class BufferPool {
+public:
+    static constexpr size_t kMinClassShift = 6;   // 64 B
+    static constexpr size_t kMaxClassShift = 18;  // 256 KiB
+    static constexpr size_t kNumClasses = kMaxClassShift - kMinClassShift + 1;
+    static constexpr size_t kSlabSize = size_t(2) << 20;
+    static constexpr size_t kRefillBytes = 64 * 1024;
+    static constexpr size_t kThreadCacheBytes = 256 * 1024;
+
+    static BufferPool& instance() {
+        // Intentionally leaked: pooled buffers may be released from static
+        // destructors and thread exit handlers after main() returns.
+        static BufferPool* pool = new BufferPool();
+        return *pool;
+    }
+
+    // Applies to slabs mapped after the call; set it before the first
+    // allocation to cover the whole pool.
+    void setHugePageMode(HugePageMode mode) { huge_page_mode.store(mode, std::memory_order_relaxed); }
+
+    // Rounds a request up to the capacity the pool will actually hand out.
+    static size_t capacityFor(size_t size) {
+        if (size <= (size_t(1) << kMinClassShift)) {
+            return size_t(1) << kMinClassShift;
+        }
+        if (size > (size_t(1) << kMaxClassShift)) {
+            return (size + kCacheLineSize - 1) & ~(kCacheLineSize - 1);
+        }
+        size_t shift = kMinClassShift;
+        while ((size_t(1) << shift) < size) {
+            ++shift;
+        }
+        return size_t(1) << shift;
+    }
+
+    char* allocate(size_t size, size_t& capacity) {
+        capacity = capacityFor(size);
+        ThreadCache& cache = localCache();
+        cache.allocated_bytes.store(cache.allocated_bytes.load(std::memory_order_relaxed) + capacity,
+                                    std::memory_order_relaxed);
+
+        int cls = classIndex(capacity);
+        if (cls < 0) {
+            bump(cache.misses);
+            return static_cast<char*>(::operator new(capacity, std::align_val_t(kCacheLineSize)));
+        }
+
+        FreeBlock* block = cache.heads[cls];
+        if (block == nullptr) {
+            bool fresh = refill(cache, cls);
+            bump(fresh ? cache.misses : cache.hits);
+            block = cache.heads[cls];
+        } else {
+            bump(cache.hits);
+        }
+        cache.heads[cls] = block->next;
+        cache.counts[cls]--;
+        return reinterpret_cast<char*>(block);
+    }
+
+    void release(char* ptr, size_t capacity) {
+        if (ptr == nullptr) {
+            return;
+        }
+        ThreadCache& cache = localCache();
+        cache.released_bytes.store(cache.released_bytes.load(std::memory_order_relaxed) + capacity,
+                                   std::memory_order_relaxed);
+
+        int cls = classIndex(capacity);
+        if (cls < 0) {
+            ::operator delete(ptr, std::align_val_t(kCacheLineSize));
+            return;
+        }
+
+        FreeBlock* block = reinterpret_cast<FreeBlock*>(ptr);
+        block->next = cache.heads[cls];
+        cache.heads[cls] = block;
+        if (++cache.counts[cls] > cacheLimit(cls)) {
+            flush(cache, cls, cache.counts[cls] / 2);
+        }
+    }
+
+    BufferPoolStats stats() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        BufferPoolStats result;
+        uint64_t allocated = retired_allocated;
+        uint64_t released = retired_released;
+        result.hits = retired_hits;
+        result.misses = retired_misses;
+        for (ThreadCache* cache : caches) {
+            result.hits += cache->hits.load(std::memory_order_relaxed);
+            result.misses += cache->misses.load(std::memory_order_relaxed);
+            allocated += cache->allocated_bytes.load(std::memory_order_relaxed);
+            released += cache->released_bytes.load(std::memory_order_relaxed);
+        }
+        result.bytes_outstanding = allocated >= released ? allocated - released : 0;
+        result.slab_bytes = slab_bytes.load(std::memory_order_relaxed);
+        result.huge_slab_bytes = huge_slab_bytes.load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct alignas(kCacheLineSize) SharedClass {
+        std::mutex mutex;
+        FreeBlock* head = nullptr;
+    };
+
+    // Counters are only written by the owning thread; atomics keep the
+    // concurrent reads from stats() well-defined without a locked RMW.
+    struct alignas(kCacheLineSize) ThreadCache {
+        FreeBlock* heads[kNumClasses] = {};
+        uint32_t counts[kNumClasses] = {};
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> allocated_bytes{0};
+        std::atomic<uint64_t> released_bytes{0};
+    };
+
+    struct ThreadCacheHandle {
+        ThreadCache cache;
+        ThreadCacheHandle() { BufferPool::instance().registerCache(&cache); }
+        ~ThreadCacheHandle() { BufferPool::instance().retireCache(&cache); }
+    };
+
+    BufferPool() = default;
+
+    static ThreadCache& localCache() {
+        static thread_local ThreadCacheHandle handle;
+        return handle.cache;
+    }
+
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static int classIndex(size_t capacity) {
+        if (capacity > (size_t(1) << kMaxClassShift)) {
+            return -1;
+        }
+        int shift = 0;
+        while ((size_t(1) << shift) < capacity) {
+            ++shift;
+        }
+        return shift - static_cast<int>(kMinClassShift);
+    }
+
+    static size_t blockSize(int cls) { return size_t(1) << (cls + kMinClassShift); }
+
+    static uint32_t cacheLimit(int cls) {
+        return static_cast<uint32_t>(std::max<size_t>(2, kThreadCacheBytes / blockSize(cls)));
+    }
+
+    static uint32_t refillCount(int cls) {
+        return static_cast<uint32_t>(std::max<size_t>(1, kRefillBytes / blockSize(cls)));
+    }
+
+    // Pulls a batch from the shared list, carving new slab memory only when
+    // the shared list is empty. Returns true if fresh memory was carved.
+    bool refill(ThreadCache& cache, int cls) {
+        uint32_t wanted = refillCount(cls);
+        SharedClass& shared = classes[cls];
+        {
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            while (shared.head != nullptr && cache.counts[cls] < wanted) {
+                FreeBlock* block = shared.head;
+                shared.head = block->next;
+                block->next = cache.heads[cls];
+                cache.heads[cls] = block;
+                cache.counts[cls]++;
+            }
+        }
+        if (cache.heads[cls] != nullptr) {
+            return false;
+        }
+
+        size_t size = blockSize(cls);
+        char* region = carve(size * wanted);
+        for (uint32_t i = 0; i < wanted; ++i) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(region + i * size);
+            block->next = cache.heads[cls];
+            cache.heads[cls] = block;
+        }
+        cache.counts[cls] += wanted;
+        return true;
+    }
+
+    void flush(ThreadCache& cache, int cls, uint32_t count) {
+        if (count == 0) {
+            return;
+        }
+        FreeBlock* first = cache.heads[cls];
+        FreeBlock* last = first;
+        for (uint32_t i = 1; i < count; ++i) {
+            last = last->next;
+        }
+        cache.heads[cls] = last->next;
+        cache.counts[cls] -= count;
+
+        SharedClass& shared = classes[cls];
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        last->next = shared.head;
+        shared.head = first;
+    }
+
+    // Bump-allocates from the current slab; the unused tail of an exhausted
+    // slab is abandoned rather than split across classes.
+    char* carve(size_t bytes) {
+        std::lock_guard<std::mutex> lock(slab_mutex);
+        if (slab_cursor == nullptr || static_cast<size_t>(slab_end - slab_cursor) < bytes) {
+            PageMapping slab = mapPages(std::max(kSlabSize, bytes), huge_page_mode.load(std::memory_order_relaxed));
+            if (slab.ptr == nullptr) {
+                throw std::bad_alloc();
+            }
+            slab_cursor = static_cast<char*>(slab.ptr);
+            slab_end = slab_cursor + slab.size;
+            slab_bytes.fetch_add(slab.size, std::memory_order_relaxed);
+            if (slab.backing != HugePageMode::Off) {
+                huge_slab_bytes.fetch_add(slab.size, std::memory_order_relaxed);
+            }
+        }
+        char* region = slab_cursor;
+        slab_cursor += bytes;
+        return region;
+    }
+
+    void registerCache(ThreadCache* cache) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        caches.push_back(cache);
+    }
+
+    void retireCache(ThreadCache* cache) {
+        for (size_t cls = 0; cls < kNumClasses; ++cls) {
+            flush(*cache, static_cast<int>(cls), cache->counts[cls]);
+        }
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        retired_hits += cache->hits.load(std::memory_order_relaxed);
+        retired_misses += cache->misses.load(std::memory_order_relaxed);
+        retired_allocated += cache->allocated_bytes.load(std::memory_order_relaxed);
+        retired_released += cache->released_bytes.load(std::memory_order_relaxed);
+        caches.erase(std::remove(caches.begin(), caches.end(), cache), caches.end());
+    }
+
+    SharedClass classes[kNumClasses];
+
+    std::mutex slab_mutex;
+    char* slab_cursor = nullptr;
+    char* slab_end = nullptr;
+    std::atomic<uint64_t> slab_bytes{0};
+    std::atomic<uint64_t> huge_slab_bytes{0};
+    std::atomic<HugePageMode> huge_page_mode{HugePageMode::Off};
+
+    std::mutex registry_mutex;
+    std::vector<ThreadCache*> caches;
+    uint64_t retired_hits = 0;
+    uint64_t retired_misses = 0;
+    uint64_t retired_allocated = 0;
+    uint64_t retired_released = 0;
+};
+
+// Move-only growable byte buffer whose storage comes from BufferPool.
+class PooledBuffer {
+public:
+    PooledBuffer() = default;
+
+    explicit PooledBuffer(size_t capacity_hint) { reserve(capacity_hint); }
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    PooledBuffer(PooledBuffer&& other) noexcept
+        : buf(std::exchange(other.buf, nullptr)),
+          len(std::exchange(other.len, 0)),
+          cap(std::exchange(other.cap, 0)) {}
+
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept {
+        if (this != &other) {
+            reset();
+            buf = std::exchange(other.buf, nullptr);
+            len = std::exchange(other.len, 0);
+            cap = std::exchange(other.cap, 0);
+        }
+        return *this;
+    }
+
+    ~PooledBuffer() { reset(); }
+
+    char* data() { return buf; }
+    const char* data() const { return buf; }
+    size_t size() const { return len; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return len == 0; }
+    std::string_view view() const { return std::string_view(buf, len); }
+
+    void clear() { len = 0; }
+
+    void reserve(size_t wanted) {
+        if (wanted <= cap) {
+            return;
+        }
+        size_t new_cap = 0;
+        char* fresh = BufferPool::instance().allocate(wanted, new_cap);
+        if (len > 0) {
+            std::memcpy(fresh, buf, len);
+        }
+        BufferPool::instance().release(buf, cap);
+        buf = fresh;
+        cap = new_cap;
+    }
+
+    // Sets the logical size after the caller has written into data()/tail().
+    void resize(size_t new_len) {
+        reserve(new_len);
+        len = new_len;
+    }
+
+    char* tail() { return buf + len; }
+    size_t spare() const { return cap - len; }
+    void commit(size_t bytes) { len += bytes; }
+
+    void append(const char* bytes, size_t count) {
+        if (len + count > cap) {
+            reserve(std::max(len + count, cap * 2));
+        }
+        std::memcpy(buf + len, bytes, count);
+        len += count;
+    }
+
+    void append(std::string_view text) { append(text.data(), text.size()); }
+
+    void push_back(char c) {
+        if (len == cap) {
+            reserve(std::max<size_t>(len + 1, cap * 2));
+        }
+        buf[len++] = c;
+    }
+
+    // Drops the first `count` bytes, sliding the remainder to the front.
+    void consume(size_t count) {
+        if (count >= len) {
+            len = 0;
+            return;
+        }
+        std::memmove(buf, buf + count, len - count);
+        len -= count;
+    }
+
+    void reset() {
+        if (buf != nullptr) {
+            BufferPool::instance().release(buf, cap);
+        }
+        buf = nullptr;
+        len = 0;
+        cap = 0;
+    }
+
+private:
+    char* buf = nullptr;
+    size_t len = 0;
+    size_t cap = 0;
+};
@@ -0,0 +1,395 @@
+#pragma once
+
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+extern char** environ;
+
+// Startup configuration, merged from (lowest to highest precedence):
+//   1. a config file: `--config path` or <PREFIX>_CONFIG; "key = value" lines, '#' comments
+//   2. environment variables: <PREFIX>_<KEY>, e.g. CONSUMER_BROKER_HOST for broker-host
+//   3. command-line flags: --key=value or --key value (a bare --flag means true)
+// Knobs are declared by reading them: each get*() records the key, default
+// and help text, so --help and the unknown-key check in validate() cover
+// exactly the settings main() uses. Parse errors are collected, not thrown.
+// Knobs read between beginReloadable() and endReloadable() may change at
+// runtime: reload() re-reads the file and the caller reads them again.
+class Config {
+public:
+    explicit Config(std::string env_prefix) : env_prefix(std::move(env_prefix)) {}
+
+    // Reads the command line and the config file. False on unusable input
+    // (missing flag value, unreadable file, malformed line).
+    bool load(int argc, char** argv, std::string& error) {
+        program = argc > 0 ? argv[0] : "";
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                help_requested = true;
+                continue;
+            }
+            if (arg.substr(0, 2) != "--" || arg.size() == 2) {
+                error = "unexpected argument '" + std::string(arg) + "'";
+                return false;
+            }
+            arg.remove_prefix(2);
+            std::string key;
+            std::string value;
+            size_t equals = arg.find('=');
+            if (equals != std::string_view::npos) {
+                key = arg.substr(0, equals);
+                value = arg.substr(equals + 1);
+            } else {
+                key = arg;
+                if (i + 1 < argc && std::string_view(argv[i + 1]).substr(0, 2) != "--") {
+                    value = argv[++i];
+                } else {
+                    value = "true";
+                }
+            }
+            cli_values[key] = value;
+        }
+
+        std::string path;
+        if (auto it = cli_values.find("config"); it != cli_values.end()) {
+            path = it->second;
+            cli_values.erase(it);
+        } else if (const char* env_path = std::getenv(envName("config").c_str())) {
+            path = env_path;
+        }
+        return path.empty() || loadFile(path, error);
+    }
+
+    // Re-reads the config file (flags and environment cannot change while the
+    // process runs) and re-resolves every knob. `restart_required` receives
+    // the changed keys that were not read as reloadable. Clears parse errors;
+    // read the knobs again, then validate(), and rollback() if it fails.
+    bool reload(std::string& error, std::vector<std::string>& restart_required) {
+        saved = Snapshot{file_values, knobs, errors};
+        if (!file_path.empty()) {
+            std::map<std::string, std::string, std::less<>> previous;
+            previous.swap(file_values);
+            if (!loadFile(file_path, error)) {
+                file_values.swap(previous);
+                return false;
+            }
+        }
+        errors.clear();
+        restart_required.clear();
+        for (auto& [key, knob] : knobs) {
+            Knob before = knob;
+            resolve(key, knob);
+            if (knob.value != before.value && !knob.reloadable) {
+                restart_required.push_back(key);
+                knob = before;  // keep reporting what is actually in effect
+            }
+        }
+        return true;
+    }
+
+    // Puts back the file values and knobs from before the last reload(), so a
+    // rejected reload leaves /config and the next reload's baseline intact.
+    void rollback() {
+        file_values = std::move(saved.file_values);
+        knobs = std::move(saved.knobs);
+        errors = std::move(saved.errors);
+    }
+
+    void beginReloadable() { reading_reloadable = true; }
+    void endReloadable() { reading_reloadable = false; }
+
+    bool helpRequested() const { return help_requested; }
+    const std::string& configFile() const { return file_path; }
+
+    std::string getString(std::string_view key, std::string_view default_value, std::string_view help) {
+        return std::string(lookup(key, default_value, help));
+    }
+
+    int64_t getInt(std::string_view key, int64_t default_value, std::string_view help,
+                   int64_t min = std::numeric_limits<int64_t>::min(),
+                   int64_t max = std::numeric_limits<int64_t>::max()) {
+        std::string_view text = lookup(key, std::to_string(default_value), help);
+        int64_t value = 0;
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+            return invalid(key, text, "an integer", default_value);
+        }
+        if (value < min || value > max) {
+            return invalid(key, text, "in [" + std::to_string(min) + ", " + std::to_string(max) + "]", default_value);
+        }
+        return value;
+    }
+
+    // Accepts k/M/G suffixes (powers of 1024), e.g. "4M".
+    size_t getSize(std::string_view key, size_t default_value, std::string_view help, size_t min = 0) {
+        std::string_view text = lookup(key, std::to_string(default_value), help);
+        uint64_t value = 0;
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        std::string_view suffix(result.ptr, text.data() + text.size() - result.ptr);
+        int shift = -1;
+        if (suffix.empty()) {
+            shift = 0;
+        } else if (suffix == "k" || suffix == "K") {
+            shift = 10;
+        } else if (suffix == "M") {
+            shift = 20;
+        } else if (suffix == "G") {
+            shift = 30;
+        }
+        if (result.ec != std::errc() || shift < 0 || value > (std::numeric_limits<uint64_t>::max() >> shift)) {
+            return invalid(key, text, "a size like 65536, 64k or 4M", default_value);
+        }
+        if ((value << shift) < min) {
+            return invalid(key, text, "a size of at least " + std::to_string(min), default_value);
+        }
+        return static_cast<size_t>(value << shift);
+    }
+
+    double getDouble(std::string_view key, double default_value, std::string_view help) {
+        std::ostringstream rendered;
+        rendered << default_value;
+        std::string text(lookup(key, rendered.str(), help));
+        char* end = nullptr;
+        double value = std::strtod(text.c_str(), &end);
+        if (text.empty() || end != text.c_str() + text.size()) {
+            return invalid(key, text, "a number", default_value);
+        }
+        return value;
+    }
+
+    bool getBool(std::string_view key, bool default_value, std::string_view help) {
+        std::string_view text = lookup(key, default_value ? "true" : "false", help);
+        if (text == "true" || text == "1" || text == "yes" || text == "on") {
+            return true;
+        }
+        if (text == "false" || text == "0" || text == "no" || text == "off") {
+            return false;
+        }
+        return invalid(key, text, "true or false", default_value);
+    }
+
+    // Plain numbers are milliseconds; "us", "ms", "s" and "m" suffixes are accepted.
+    // Microseconds round up, so a non-zero value never becomes 0 ms.
+    std::chrono::milliseconds getMillis(std::string_view key, std::chrono::milliseconds default_value,
+                                        std::string_view help) {
+        std::string_view text = lookup(key, std::to_string(default_value.count()) + "ms", help);
+        int64_t value = 0;
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        std::string_view unit(result.ptr, text.data() + text.size() - result.ptr);
+        if (result.ec == std::errc() && value >= 0) {
+            if (unit.empty() || unit == "ms") {
+                return std::chrono::milliseconds(value);
+            }
+            if (unit == "us") {
+                return std::chrono::milliseconds(value / 1000 + (value % 1000 != 0 ? 1 : 0));
+            }
+            if (unit == "s") {
+                return std::chrono::seconds(value);
+            }
+            if (unit == "m") {
+                return std::chrono::minutes(value);
+            }
+        }
+        return invalid(key, text, "a duration like 250ms or 3s", default_value);
+    }
+
+    // Comma-separated; empty items are skipped.
+    std::vector<std::string> getList(std::string_view key, std::string_view default_value, std::string_view help) {
+        std::string_view text = lookup(key, default_value, help);
+        std::vector<std::string> items;
+        while (!text.empty()) {
+            size_t comma = text.find(',');
+            std::string_view item = trim(text.substr(0, comma));
+            text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+            if (!item.empty()) {
+                items.emplace_back(item);
+            }
+        }
+        return items;
+    }
+
+    // Records a value main() rejected after reading it (e.g. an unknown enum name).
+    void reject(std::string_view key, std::string_view expected) {
+        auto it = knobs.find(key);
+        errors.push_back(std::string(key) + ": expected " + std::string(expected) + ", got '" +
+                         (it != knobs.end() ? it->second.value : std::string()) + "'");
+    }
+
+    // Call after every knob has been read: reports malformed values and keys
+    // that were given but never read (usually typos).
+    bool validate(std::string& error) const {
+        std::vector<std::string> problems = errors;
+        for (const auto& [key, value] : cli_values) {
+            if (!knobs.contains(key)) {
+                problems.push_back("unknown option --" + key);
+            }
+        }
+        for (const auto& [key, value] : file_values) {
+            if (!knobs.contains(key)) {
+                problems.push_back("unknown key '" + key + "' in " + file_path);
+            }
+        }
+        std::string prefix = env_prefix + "_";
+        for (char** entry = environ; entry != nullptr && *entry != nullptr; ++entry) {
+            std::string_view variable = *entry;
+            std::string_view name = variable.substr(0, variable.find('='));
+            if (name.substr(0, prefix.size()) == prefix && name != envName("config") &&
+                !env_names.contains(name)) {
+                problems.push_back("unknown environment variable " + std::string(name));
+            }
+        }
+        error.clear();
+        for (const std::string& problem : problems) {
+            error += (error.empty() ? "" : "; ") + problem;
+        }
+        return problems.empty();
+    }
+
+    void printHelp(std::ostream& out) const {
+        out << "Usage: " << program << " [--config FILE] [--key=value ...]\n"
+            << "Every key can also be set as " << env_prefix << "_<KEY> in the environment or as\n"
+            << "'key = value' in the config file. Command line > environment > file > default.\n\n";
+        for (const auto& [key, knob] : knobs) {
+            out << "  --" << std::left << std::setw(28) << key << knob.help << " (default: "
+                << (knob.default_value.empty() ? "\"\"" : knob.default_value) << ")"
+                << (knob.reloadable ? " [reloadable]" : "") << "\n";
+        }
+    }
+
+    // Effective settings that differ from their defaults, with their source.
+    void print(std::ostream& out, const char* prefix) const {
+        for (const auto& [key, knob] : knobs) {
+            if (knob.source != Source::Default) {
+                out << prefix << (*prefix != '\0' ? " " : "") << "Config " << key << " = " << knob.value << " (" << sourceName(knob.source) << ")\n";
+            }
+        }
+        out << std::flush;
+    }
+
+private:
+    enum class Source { Default, File, Environment, CommandLine };
+
+    struct Knob {
+        std::string value;
+        std::string default_value;
+        std::string help;
+        Source source = Source::Default;
+        bool reloadable = false;
+    };
+
+    static const char* sourceName(Source source) {
+        switch (source) {
+            case Source::File: return "file";
+            case Source::Environment: return "env";
+            case Source::CommandLine: return "command line";
+            default: return "default";
+        }
+    }
+
+    static std::string_view trim(std::string_view text) {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    std::string envName(std::string_view key) const {
+        std::string name = env_prefix + "_";
+        for (char c : key) {
+            name.push_back(c == '-' || c == '.' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+        }
+        return name;
+    }
+
+    bool loadFile(const std::string& path, std::string& error) {
+        std::ifstream in(path);
+        if (!in) {
+            error = "cannot read config file " + path;
+            return false;
+        }
+        file_path = path;
+        std::string line;
+        for (int line_number = 1; std::getline(in, line); ++line_number) {
+            std::string_view text = line;
+            text = trim(text.substr(0, text.find('#')));
+            if (text.empty()) {
+                continue;
+            }
+            size_t equals = text.find('=');
+            if (equals == std::string_view::npos || trim(text.substr(0, equals)).empty()) {
+                error = path + ":" + std::to_string(line_number) + ": expected 'key = value'";
+                return false;
+            }
+            file_values[std::string(trim(text.substr(0, equals)))] = std::string(trim(text.substr(equals + 1)));
+        }
+        return true;
+    }
+
+    // Registers the knob and returns its effective text.
+    std::string_view lookup(std::string_view key, std::string_view default_value, std::string_view help) {
+        Knob& knob = knobs[std::string(key)];
+        knob.default_value = default_value;
+        knob.help = help;
+        knob.reloadable = knob.reloadable || reading_reloadable;
+        env_names.insert(envName(key));
+        resolve(key, knob);
+        return knob.value;
+    }
+
+    void resolve(std::string_view key, Knob& knob) const {
+        if (auto it = cli_values.find(key); it != cli_values.end()) {
+            knob.value = it->second;
+            knob.source = Source::CommandLine;
+        } else if (const char* env_value = std::getenv(envName(key).c_str())) {
+            knob.value = env_value;
+            knob.source = Source::Environment;
+        } else if (auto file_it = file_values.find(key); file_it != file_values.end()) {
+            knob.value = file_it->second;
+            knob.source = Source::File;
+        } else {
+            knob.value = knob.default_value;
+            knob.source = Source::Default;
+        }
+    }
+
+    template <typename T>
+    T invalid(std::string_view key, std::string_view text, std::string_view expected, T default_value) {
+        errors.push_back(std::string(key) + ": expected " + std::string(expected) + ", got '" + std::string(text) + "'");
+        return default_value;
+    }
+
+    std::string env_prefix;
+    std::string program;
+    std::string file_path;
+    bool help_requested = false;
+    bool reading_reloadable = false;
+    std::map<std::string, std::string, std::less<>> cli_values;
+    std::map<std::string, std::string, std::less<>> file_values;
+    std::map<std::string, Knob, std::less<>> knobs;
+    std::set<std::string, std::less<>> env_names;
+    std::vector<std::string> errors;
+
+    struct Snapshot {
+        std::map<std::string, std::string, std::less<>> file_values;
+        std::map<std::string, Knob, std::less<>> knobs;
+        std::vector<std::string> errors;
+    };
+    Snapshot saved;  // state before the last reload()
+};
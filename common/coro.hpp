@@ -0,0 +1,157 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include "buffer_pool.hpp"
+
+// Coroutine frames are carved from BufferPool instead of the global heap, so
+// steady-state creation of Tasks does not malloc/free.
+struct PooledFrameAllocator {
+    static void* operator new(size_t size) {
+        size_t capacity = 0;
+        return BufferPool::instance().allocate(size, capacity);
+    }
+
+    static void operator delete(void* ptr, size_t size) {
+        BufferPool::instance().release(static_cast<char*>(ptr), BufferPool::capacityFor(size));
+    }
+};
+
+template <typename T>
+class Task;
+
+namespace coro_detail {
+
+struct PromiseBase : PooledFrameAllocator {
+    std::coroutine_handle<> continuation = std::noop_coroutine();
+    std::exception_ptr error;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    // Symmetric transfer back to whoever awaited us.
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object() noexcept;
+    template <typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+    T take() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept;
+    void return_void() noexcept {}
+    void take() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+}  // namespace coro_detail
+
+// Lazily started, single-awaiter coroutine. `co_await task` starts it and
+// resumes the awaiting coroutine when it finishes.
+template <typename T = void>
+class [[nodiscard]] Task {
+public:
+    using promise_type = coro_detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) : handle(handle) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return !handle || handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume() { return handle.promise().take(); }
+
+    // For a task started by resuming this handle (e.g. EventLoop::post())
+    // instead of being awaited. The Task keeps ownership: destroying it
+    // destroys the coroutine, wherever it is suspended.
+    std::coroutine_handle<> startHandle() const noexcept { return handle; }
+
+private:
+    Handle handle;
+};
+
+namespace coro_detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// Fire-and-forget wrapper that owns a Task and frees itself when done. It
+// starts suspended so an event loop can schedule the first resume.
+struct Detached {
+    struct promise_type : PooledFrameAllocator {
+        Detached get_return_object() noexcept {
+            return Detached{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<> handle;
+};
+
+inline Detached detach(Task<void> task) {
+    co_await task;
+}
+
+}  // namespace coro_detail
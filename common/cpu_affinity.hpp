@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <string_view>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "buffer_pool.hpp"
+
+// Parses a Linux-style CPU list ("0-3,8,10-11"). Returns false on bad input.
+inline bool parseCpuList(std::string_view text, std::vector<int>& cpus) {
+    cpus.clear();
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view item = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+        if (item.empty()) {
+            continue;
+        }
+        size_t dash = item.find('-');
+        try {
+            int first = std::stoi(std::string(item.substr(0, dash)));
+            int last = dash == std::string_view::npos ? first : std::stoi(std::string(item.substr(dash + 1)));
+            if (first < 0 || last < first) {
+                return false;
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool pinCurrentThread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+inline int numaNodeOfCurrentCpu() {
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return -1;
+    }
+    return static_cast<int>(node);
+}
+
+// Prefers the current NUMA node for pages this thread faults in from now on
+// (MPOL_PREFERRED via set_mempolicy, so no libnuma dependency). Buffers are
+// first-touched by their owning thread, which makes this enough to keep the
+// receive ring, arena chunks and freshly carved slabs node-local.
+inline bool preferLocalNumaNode() {
+    int node = numaNodeOfCurrentCpu();
+    if (node < 0 || node >= static_cast<int>(sizeof(unsigned long) * 8)) {
+        return false;
+    }
+    constexpr int kMpolPreferred = 1;
+    unsigned long mask = 1ul << node;
+    return syscall(SYS_set_mempolicy, kMpolPreferred, &mask, sizeof(mask) * 8 + 1) == 0;
+}
+
+// Per-thread counters, one cache line each so cores never share a line.
+// Only the owning thread writes; reporting threads read relaxed. `cpu` and
+// `numa_node` are plain ints set once, under CoreRuntime's mutex.
+struct alignas(kCacheLineSize) CoreStats {
+    std::string role;
+    int cpu = -1;
+    int numa_node = -1;
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> migrations{0};
+    std::atomic<uint64_t> voluntary_switches{0};
+    std::atomic<uint64_t> involuntary_switches{0};
+    int last_cpu = -1;
+
+    void record(size_t message_bytes) {
+        messages.store(messages.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        bytes.store(bytes.load(std::memory_order_relaxed) + message_bytes, std::memory_order_relaxed);
+        int now = sched_getcpu();
+        if (last_cpu >= 0 && now != last_cpu) {
+            migrations.store(migrations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        last_cpu = now;
+    }
+
+    // Must be called from the owning thread (RUSAGE_THREAD is per-caller).
+    void sampleScheduler() {
+        rusage usage;
+        if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+            voluntary_switches.store(static_cast<uint64_t>(usage.ru_nvcsw), std::memory_order_relaxed);
+            involuntary_switches.store(static_cast<uint64_t>(usage.ru_nivcsw), std::memory_order_relaxed);
+        }
+    }
+};
+
+// Thread-per-core runtime: every I/O loop or worker registers here and is
+// pinned to the next CPU of the configured set (round-robin). With an empty
+// set threads float freely but still get per-thread statistics.
+class CoreRuntime {
+public:
+    CoreRuntime(std::vector<int> cpus, bool numa_local) : cpus(std::move(cpus)), numa_local(numa_local) {}
+
+    bool pinned() const { return !cpus.empty(); }
+
+    // Pins the calling thread and returns its stats slot.
+    CoreStats& attachCurrentThread(const std::string& role) {
+        CoreStats* stats;
+        int cpu = -1;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats = &slots.emplace_back();
+            stats->role = role;
+            if (!cpus.empty()) {
+                cpu = cpus[next_cpu++ % cpus.size()];
+            }
+        }
+        if (cpu >= 0 && !pinCurrentThread(cpu)) {
+            std::cerr << "Failed to pin " << role << " thread to CPU " << cpu << std::endl;
+            cpu = -1;
+        }
+        if (cpu >= 0 && numa_local && !preferLocalNumaNode()) {
+            std::cerr << "Failed to set NUMA-local memory policy for " << role << " thread" << std::endl;
+        }
+        int numa_node = numaNodeOfCurrentCpu();
+        {
+            // report() reads these under the same lock
+            std::lock_guard<std::mutex> lock(mutex);
+            stats->cpu = cpu;
+            stats->numa_node = numa_node;
+        }
+        stats->last_cpu = sched_getcpu();
+        return *stats;
+    }
+
+    // Starts `fn(CoreStats&)` on a new thread bound to the next CPU.
+    template <typename Fn>
+    std::thread spawn(std::string role, Fn fn) {
+        return std::thread([this, role = std::move(role), fn = std::move(fn)]() mutable {
+            // Shows up in top -H, perf and trace exports (15 chars max)
+            pthread_setname_np(pthread_self(), role.substr(0, 15).c_str());
+            CoreStats& stats = attachCurrentThread(role);
+            fn(stats);
+            stats.sampleScheduler();
+        });
+    }
+
+    void report(std::ostream& out, const char* prefix) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const CoreStats& stats : slots) {
+            out << prefix << " Thread " << stats.role << ": cpu=" << (stats.cpu >= 0 ? std::to_string(stats.cpu) : "any")
+                << " node=" << stats.numa_node << " messages=" << stats.messages.load(std::memory_order_relaxed)
+                << " bytes=" << stats.bytes.load(std::memory_order_relaxed)
+                << " migrations=" << stats.migrations.load(std::memory_order_relaxed)
+                << " ctx-switches=" << stats.voluntary_switches.load(std::memory_order_relaxed) << "/"
+                << stats.involuntary_switches.load(std::memory_order_relaxed) << " (voluntary/involuntary)"
+                << std::endl;
+        }
+    }
+
+private:
+    std::vector<int> cpus;
+    bool numa_local;
+    std::mutex mutex;
+    std::deque<CoreStats> slots;
+    size_t next_cpu = 0;
+};
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Matches destinations against Artemis-style wildcard patterns. Words are
+// separated by '.', '*' matches exactly one word and '#' matches zero or
+// more words, so "news.*.sports" matches "news.eu.sports" and "news.#"
+// matches "news", "news.eu" and "news.eu.sports".
+//
+// Patterns are inserted into a build tree, then compile() flattens it into
+// arrays: per node a hash-sorted edge range for literal words plus direct
+// links to its '*' and '#' children. match() walks the destination once,
+// advancing a set of active nodes per word, so its cost is proportional to
+// the number of words times the (small) number of live wildcard branches,
+// not to the number of patterns. Each value is a caller-defined id such as
+// a handler index.
+//
+// match() reuses internal scratch space and must not be called concurrently.
+class DestinationTrie {
+public:
+    static constexpr char kDelimiter = '.';
+
+    DestinationTrie() : build_root(std::make_unique<BuildNode>()) {}
+
+    void insert(std::string_view pattern, uint32_t value) {
+        BuildNode* node = build_root.get();
+        forEachWord(pattern, [&](std::string_view word) {
+            std::unique_ptr<BuildNode>& child = node->children[std::string(word)];
+            if (!child) {
+                child = std::make_unique<BuildNode>();
+            }
+            node = child.get();
+        });
+        node->values.push_back(value);
+        ++pattern_count;
+        compiled = false;
+    }
+
+    size_t patternCount() const { return pattern_count; }
+    size_t nodeCount() const { return nodes.size(); }
+
+    // Called automatically by match() after inserts.
+    void compile() {
+        nodes.clear();
+        edges.clear();
+        values.clear();
+        words.clear();
+        nodes.push_back(Node{});
+        flatten(*build_root, 0, false);
+        stamps.assign(nodes.size(), 0);
+        generation = 0;
+        compiled = true;
+    }
+
+    // Appends the value of every pattern matching `destination` to `out`
+    // (each pattern once) and returns how many were appended.
+    size_t match(std::string_view destination, std::vector<uint32_t>& out) {
+        if (!compiled) {
+            compile();
+        }
+        current.clear();
+        nextGeneration();
+        enter(0, current);
+
+        bool alive = true;
+        forEachWord(destination, [&](std::string_view word) {
+            if (!alive) {
+                return;
+            }
+            next.clear();
+            nextGeneration();
+            uint64_t word_hash = hashWord(word);
+            for (uint32_t index : current) {
+                const Node& node = nodes[index];
+                if (node.is_hash) {
+                    enter(index, next);  // '#' absorbs another word
+                }
+                if (node.star >= 0) {
+                    enter(static_cast<uint32_t>(node.star), next);
+                }
+                int32_t literal = findEdge(node, word_hash, word);
+                if (literal >= 0) {
+                    enter(static_cast<uint32_t>(literal), next);
+                }
+            }
+            current.swap(next);
+            alive = !current.empty();
+        });
+
+        size_t before = out.size();
+        for (uint32_t index : current) {
+            const Node& node = nodes[index];
+            out.insert(out.end(), values.begin() + node.first_value,
+                       values.begin() + node.first_value + node.value_count);
+        }
+        return out.size() - before;
+    }
+
+    static bool hasWildcard(std::string_view pattern) {
+        bool wildcard = false;
+        forEachWord(pattern, [&](std::string_view word) { wildcard = wildcard || word == "*" || word == "#"; });
+        return wildcard;
+    }
+
+private:
+    struct BuildNode {
+        std::map<std::string, std::unique_ptr<BuildNode>> children;
+        std::vector<uint32_t> values;
+    };
+
+    struct Node {
+        uint32_t first_edge = 0;
+        uint32_t edge_count = 0;
+        uint32_t first_value = 0;
+        uint32_t value_count = 0;
+        int32_t star = -1;
+        int32_t hash = -1;
+        bool is_hash = false;
+    };
+
+    struct Edge {
+        uint64_t hash;
+        uint32_t word_offset;
+        uint32_t word_length;
+        uint32_t child;
+    };
+
+    template <typename Fn>
+    static void forEachWord(std::string_view text, Fn&& fn) {
+        size_t start = 0;
+        for (;;) {
+            size_t end = text.find(kDelimiter, start);
+            if (end == std::string_view::npos) {
+                fn(text.substr(start));
+                return;
+            }
+            fn(text.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    // FNV-1a
+    static uint64_t hashWord(std::string_view word) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (char c : word) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    void flatten(const BuildNode& source, uint32_t index, bool is_hash) {
+        nodes[index].is_hash = is_hash;
+        nodes[index].first_value = static_cast<uint32_t>(values.size());
+        nodes[index].value_count = static_cast<uint32_t>(source.values.size());
+        values.insert(values.end(), source.values.begin(), source.values.end());
+
+        // Reserve this node's edge range before recursing so it stays contiguous
+        std::vector<std::pair<const std::string*, const BuildNode*>> literals;
+        for (const auto& [word, child] : source.children) {
+            if (word != "*" && word != "#") {
+                literals.emplace_back(&word, child.get());
+            }
+        }
+        uint32_t first_edge = static_cast<uint32_t>(edges.size());
+        nodes[index].first_edge = first_edge;
+        nodes[index].edge_count = static_cast<uint32_t>(literals.size());
+        for (const auto& [word, child] : literals) {
+            edges.push_back(Edge{hashWord(*word), static_cast<uint32_t>(words.size()),
+                                 static_cast<uint32_t>(word->size()), 0});
+            words.append(*word);
+        }
+        std::sort(edges.begin() + first_edge, edges.end(),
+                  [](const Edge& a, const Edge& b) { return a.hash < b.hash; });
+
+        for (uint32_t e = first_edge; e < first_edge + literals.size(); ++e) {
+            std::string_view word(words.data() + edges[e].word_offset, edges[e].word_length);
+            const BuildNode* child = source.children.find(std::string(word))->second.get();
+            uint32_t child_index = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(Node{});
+            edges[e].child = child_index;
+            flatten(*child, child_index, false);
+        }
+        for (const char* wildcard : {"*", "#"}) {
+            auto it = source.children.find(wildcard);
+            if (it == source.children.end()) {
+                continue;
+            }
+            uint32_t child_index = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(Node{});
+            (*wildcard == '*' ? nodes[index].star : nodes[index].hash) = static_cast<int32_t>(child_index);
+            flatten(*it->second, child_index, *wildcard == '#');
+        }
+    }
+
+    int32_t findEdge(const Node& node, uint64_t word_hash, std::string_view word) const {
+        auto first = edges.begin() + node.first_edge;
+        auto last = first + node.edge_count;
+        auto it = std::lower_bound(first, last, word_hash,
+                                   [](const Edge& edge, uint64_t hash) { return edge.hash < hash; });
+        for (; it != last && it->hash == word_hash; ++it) {
+            if (std::string_view(words.data() + it->word_offset, it->word_length) == word) {
+                return static_cast<int32_t>(it->child);
+            }
+        }
+        return -1;
+    }
+
+    void nextGeneration() {
+        if (++generation == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            generation = 1;
+        }
+    }
+
+    // Adds a node to the active set, plus the '#' child it can reach
+    // without consuming a word.
+    void enter(uint32_t index, std::vector<uint32_t>& active) {
+        while (stamps[index] != generation) {
+            stamps[index] = generation;
+            active.push_back(index);
+            if (nodes[index].hash < 0) {
+                return;
+            }
+            index = static_cast<uint32_t>(nodes[index].hash);
+        }
+    }
+
+    std::unique_ptr<BuildNode> build_root;
+    size_t pattern_count = 0;
+    bool compiled = false;
+
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    std::vector<uint32_t> values;
+    std::string words;
+
+    std::vector<uint32_t> stamps;
+    uint32_t generation = 0;
+    std::vector<uint32_t> current;
+    std::vector<uint32_t> next;
+};
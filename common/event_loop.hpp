@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <queue>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "coro.hpp"
+#include "latency.hpp"
+
+// Single-threaded epoll loop that resumes coroutines when their fd becomes
+// ready or their timer expires. All awaitables must be used from the loop
+// thread; run() returns once nothing is waiting any more or stop() is called.
+class EventLoop {
+public:
+    EventLoop() : epoll_fd(epoll_create1(EPOLL_CLOEXEC)) {}
+
+    ~EventLoop() {
+        if (epoll_fd >= 0) {
+            close(epoll_fd);
+        }
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    bool valid() const { return epoll_fd >= 0; }
+
+    // Starts `task` on the next loop iteration; its frame is freed on completion.
+    void spawn(Task<void> task) {
+        post(coro_detail::detach(std::move(task)).handle);
+    }
+
+    void post(std::coroutine_handle<> handle) { ready.push_back(handle); }
+
+    void stop() { stopped = true; }
+
+    void run() {
+        stopped = false;
+        std::vector<epoll_event> events(64);
+        while (!stopped) {
+            while (!ready.empty() && !stopped) {
+                std::coroutine_handle<> handle = ready.front();
+                ready.pop_front();
+                handle.resume();
+            }
+            if (stopped || (watches.empty() && timers.empty() && ready.empty())) {
+                break;
+            }
+            if (!ready.empty()) {
+                continue;
+            }
+
+            int timeout_ms = -1;
+            if (!timers.empty()) {
+                uint64_t now = monotonicNs();
+                uint64_t deadline = timers.top().deadline;
+                timeout_ms = deadline <= now ? 0 : static_cast<int>((deadline - now + 999'999) / 1'000'000);
+            }
+            int count = epoll_wait(epoll_fd, events.data(), static_cast<int>(events.size()), timeout_ms);
+            if (count < 0 && errno != EINTR) {
+                break;
+            }
+            for (int i = 0; i < count; ++i) {
+                dispatch(events[i].data.fd, events[i].events);
+            }
+            uint64_t now = monotonicNs();
+            while (!timers.empty() && timers.top().deadline <= now) {
+                ready.push_back(timers.top().handle);
+                timers.pop();
+            }
+        }
+    }
+
+    // co_await loop.readable(fd) / loop.writable(fd): suspends until epoll
+    // reports the fd ready (or hung up / errored, which also wakes readers).
+    struct FdAwaiter {
+        EventLoop& loop;
+        int fd;
+        uint32_t event;
+
+        bool await_ready() const noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> handle) { return loop.watch(fd, event, handle); }
+        void await_resume() const noexcept {}
+    };
+
+    FdAwaiter readable(int fd) { return FdAwaiter{*this, fd, EPOLLIN}; }
+    FdAwaiter writable(int fd) { return FdAwaiter{*this, fd, EPOLLOUT}; }
+
+    struct SleepAwaiter {
+        EventLoop& loop;
+        uint64_t deadline;
+
+        bool await_ready() const noexcept { return deadline <= monotonicNs(); }
+        void await_suspend(std::coroutine_handle<> handle) { loop.timers.push(Timer{deadline, handle}); }
+        void await_resume() const noexcept {}
+    };
+
+    SleepAwaiter sleepFor(std::chrono::nanoseconds duration) {
+        return SleepAwaiter{*this, monotonicNs() + static_cast<uint64_t>(duration.count())};
+    }
+
+    // Drops any registration for a descriptor that is about to be closed.
+    // Waiters are woken so they can observe the closed state, unless `wake`
+    // is false because their frames are about to be destroyed.
+    void forget(int fd, bool wake = true) {
+        auto it = watches.find(fd);
+        if (it == watches.end()) {
+            return;
+        }
+        if (wake && it->second.reader) {
+            ready.push_back(it->second.reader);
+        }
+        if (wake && it->second.writer) {
+            ready.push_back(it->second.writer);
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        watches.erase(it);
+    }
+
+    // Removes queued resumptions of `handle`, before its frame is destroyed.
+    void cancel(std::coroutine_handle<> handle) {
+        if (handle) {
+            std::erase(ready, handle);
+        }
+    }
+
+private:
+    struct Watch {
+        std::coroutine_handle<> reader;
+        std::coroutine_handle<> writer;
+    };
+
+    struct Timer {
+        uint64_t deadline;
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer& other) const { return deadline > other.deadline; }
+    };
+
+    static uint32_t interest(const Watch& watch) {
+        return (watch.reader ? EPOLLIN : 0u) | (watch.writer ? EPOLLOUT : 0u);
+    }
+
+    bool watch(int fd, uint32_t event, std::coroutine_handle<> handle) {
+        auto [it, inserted] = watches.try_emplace(fd);
+        Watch& w = it->second;
+        (event == EPOLLIN ? w.reader : w.writer) = handle;
+        epoll_event ev{};
+        ev.events = interest(w);
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, inserted ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) < 0) {
+            (event == EPOLLIN ? w.reader : w.writer) = nullptr;
+            if (inserted) {
+                watches.erase(it);
+            }
+            return false;  // resume immediately; the caller's next I/O call reports the error
+        }
+        return true;
+    }
+
+    void dispatch(int fd, uint32_t events) {
+        auto it = watches.find(fd);
+        if (it == watches.end()) {
+            return;
+        }
+        Watch& w = it->second;
+        bool failed = (events & (EPOLLERR | EPOLLHUP)) != 0;
+        if (w.reader && (failed || (events & EPOLLIN))) {
+            ready.push_back(std::exchange(w.reader, nullptr));
+        }
+        if (w.writer && (failed || (events & EPOLLOUT))) {
+            ready.push_back(std::exchange(w.writer, nullptr));
+        }
+        if (!w.reader && !w.writer) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            watches.erase(it);
+        } else {
+            epoll_event ev{};
+            ev.events = interest(w);
+            ev.data.fd = fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+        }
+    }
+
+    int epoll_fd;
+    bool stopped = false;
+    std::deque<std::coroutine_handle<>> ready;
+    std::unordered_map<int, Watch> watches;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+};
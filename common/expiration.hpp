@@ -0,0 +1,30 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+
+#include "stomp_frame.hpp"
+
+// Message expiry uses the JMS/Artemis `expires` header: absolute wall-clock
+// time in milliseconds since the epoch, 0 or absent meaning "never".
+
+// Expiry for a message sent at `sent_at_ns` (realtimeNs()); 0 if ttl <= 0.
+inline uint64_t expiresAt(uint64_t sent_at_ns, std::chrono::milliseconds ttl) {
+    if (ttl.count() <= 0) {
+        return 0;
+    }
+    return sent_at_ns / 1'000'000 + static_cast<uint64_t>(ttl.count());
+}
+
+// Header-table lookup only, so expired messages are dropped before the body
+// is decoded. Unparseable values are treated as "never expires".
+inline bool isExpired(const StompFrameView& frame, uint64_t now_ms) {
+    const StompHeader* expires = frame.findHeader("expires");
+    if (expires == nullptr) {
+        return false;
+    }
+    uint64_t expires_ms = 0;
+    auto result = std::from_chars(expires->value.data(), expires->value.data() + expires->value.size(), expires_ms);
+    return result.ec == std::errc() && expires_ms != 0 && expires_ms <= now_ms;
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "latency.hpp"
+#include "stomp_frame.hpp"
+
+// Capture file layout (host byte order):
+//   CaptureFileHeader, then records of CaptureRecordHeader + `size` frame bytes
+// Records are written in arrival order, so offsets are non-decreasing. The
+// file is preallocated in chunks; a record header with size 0 marks the end,
+// which also makes a capture cut short by a crash readable up to that point.
+struct CaptureFileHeader {
+    char magic[8];               // "STMPCAP1"
+    uint64_t start_realtime_ns;  // wall clock when the capture began
+};
+
+enum class CaptureDirection : uint8_t {
+    Sent = 0,
+    Received = 1,
+};
+
+struct CaptureRecordHeader {
+    uint64_t offset_ns;  // monotonic time since the capture began
+    uint32_t size;
+    uint8_t direction;   // CaptureDirection
+    uint8_t reserved[3];
+};
+
+inline constexpr char kCaptureMagic[8] = {'S', 'T', 'M', 'P', 'C', 'A', 'P', '1'};
+
+// Appends frames to a memory-mapped capture file. Appends are serialized by
+// a mutex and cost one memcpy; the mapping grows by `chunk_bytes` at a time.
+// Safe to call from several threads.
+class FrameCapture {
+public:
+    FrameCapture() = default;
+    ~FrameCapture() { close(); }
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    bool open(const std::string& path, size_t chunk_bytes, std::string& error) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            error = "cannot create " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        chunk = std::max<size_t>(chunk_bytes, 1 << 20);
+        if (!grow(chunk)) {
+            error = "cannot map " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        CaptureFileHeader header{};
+        std::memcpy(header.magic, kCaptureMagic, sizeof(header.magic));
+        header.start_realtime_ns = realtimeNs();
+        std::memcpy(base, &header, sizeof(header));
+        used = sizeof(header);
+        start_ns = monotonicNs();
+        return true;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    void record(CaptureDirection direction, const char* data, size_t size) {
+        if (fd < 0 || size == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t needed = used + sizeof(CaptureRecordHeader) + size + sizeof(CaptureRecordHeader);
+        if (needed > capacity && !grow(((needed + chunk - 1) / chunk) * chunk)) {
+            ++dropped;
+            return;
+        }
+        CaptureRecordHeader header{};
+        header.offset_ns = monotonicNs() - start_ns;
+        header.size = static_cast<uint32_t>(size);
+        header.direction = static_cast<uint8_t>(direction);
+        std::memcpy(base + used, &header, sizeof(header));
+        std::memcpy(base + used + sizeof(header), data, size);
+        used += sizeof(header) + size;
+        ++records;
+    }
+
+    // One record per iovec, as handed to writev().
+    void record(CaptureDirection direction, const iovec* frames, int count) {
+        for (int i = 0; i < count; ++i) {
+            record(direction, static_cast<const char*>(frames[i].iov_base), frames[i].iov_len);
+        }
+    }
+
+    void record(CaptureDirection direction, const PooledBuffer& frame) {
+        record(direction, frame.data(), frame.size());
+    }
+
+    // A frame parsed by parseStompFrame(): command through the trailing NUL.
+    void record(CaptureDirection direction, const StompFrameView& frame) {
+        record(direction, frame.command.data(),
+               static_cast<size_t>(frame.body.data() + frame.body.size() + 1 - frame.command.data()));
+    }
+
+    // Trims the file to the bytes written.
+    void close() {
+        if (fd < 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        munmap(base, capacity);
+        if (ftruncate(fd, static_cast<off_t>(used)) != 0) {
+            // keep the preallocated tail; readers stop at the zero header
+        }
+        ::close(fd);
+        fd = -1;
+        base = nullptr;
+        capacity = 0;
+    }
+
+    uint64_t recordCount() const { return records; }
+    uint64_t bytesWritten() const { return used; }
+    uint64_t droppedCount() const { return dropped; }
+
+private:
+    bool grow(size_t new_capacity) {
+        if (ftruncate(fd, static_cast<off_t>(new_capacity)) != 0) {
+            return false;
+        }
+        void* mapped = base == nullptr
+                           ? mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                           : mremap(base, capacity, new_capacity, MREMAP_MAYMOVE);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        base = static_cast<char*>(mapped);
+        capacity = new_capacity;
+        return true;
+    }
+
+    int fd = -1;
+    char* base = nullptr;
+    size_t capacity = 0;
+    size_t chunk = 0;
+    size_t used = 0;
+    uint64_t start_ns = 0;
+    uint64_t records = 0;
+    uint64_t dropped = 0;
+    std::mutex mutex;
+};
+
+struct CaptureRecord {
+    uint64_t offset_ns;
+    CaptureDirection direction;
+    std::string_view frame;  // points into the reader's mapping
+};
+
+// Iterates a capture file through a read-only mapping.
+class CaptureReader {
+public:
+    CaptureReader() = default;
+    ~CaptureReader() {
+        if (base != nullptr) {
+            munmap(const_cast<char*>(base), size);
+        }
+    }
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    bool open(const std::string& path, std::string& error) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            error = "cannot open " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat info {};
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CaptureFileHeader)) {
+            error = path + " is not a capture file";
+            ::close(fd);
+            return false;
+        }
+        size = static_cast<size_t>(info.st_size);
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            error = "cannot map " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        base = static_cast<const char*>(mapped);
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        CaptureFileHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, kCaptureMagic, sizeof(header.magic)) != 0) {
+            error = path + " is not a capture file";
+            return false;
+        }
+        start_realtime_ns = header.start_realtime_ns;
+        rewind();
+        return true;
+    }
+
+    void rewind() { position = sizeof(CaptureFileHeader); }
+
+    // False at the end of the capture (or at a truncated record).
+    bool next(CaptureRecord& out) {
+        if (position + sizeof(CaptureRecordHeader) > size) {
+            return false;
+        }
+        CaptureRecordHeader header;
+        std::memcpy(&header, base + position, sizeof(header));
+        if (header.size == 0 || position + sizeof(header) + header.size > size) {
+            return false;
+        }
+        out.offset_ns = header.offset_ns;
+        out.direction = static_cast<CaptureDirection>(header.direction);
+        out.frame = std::string_view(base + position + sizeof(header), header.size);
+        position += sizeof(header) + header.size;
+        return true;
+    }
+
+    uint64_t startRealtimeNs() const { return start_realtime_ns; }
+
+private:
+    const char* base = nullptr;
+    size_t size = 0;
+    size_t position = 0;
+    uint64_t start_realtime_ns = 0;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <sys/mman.h>
+
+constexpr size_t kHugePageSize = size_t(2) << 20;
+
+enum class HugePageMode {
+    Off,          // normal 4 KB pages
+    Transparent,  // 2 MB aligned mapping + MADV_HUGEPAGE, promoted by khugepaged/fault path
+    Explicit,     // MAP_HUGETLB from the reserved hugetlbfs pool
+};
+
+inline const char* hugePageModeName(HugePageMode mode) {
+    switch (mode) {
+        case HugePageMode::Transparent: return "transparent";
+        case HugePageMode::Explicit: return "explicit";
+        default: return "off";
+    }
+}
+
+inline bool parseHugePageMode(std::string_view text, HugePageMode& mode) {
+    if (text == "off" || text == "none" || text == "0" || text == "false") {
+        mode = HugePageMode::Off;
+    } else if (text == "transparent" || text == "thp") {
+        mode = HugePageMode::Transparent;
+    } else if (text == "explicit" || text == "hugetlb" || text == "1" || text == "true") {
+        mode = HugePageMode::Explicit;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline size_t roundUpTo(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+struct PageMapping {
+    void* ptr = nullptr;
+    size_t size = 0;
+    HugePageMode backing = HugePageMode::Off;
+};
+
+// Reserves `bytes` (+ alignment slack) and trims it to a 2 MB aligned window
+// so the kernel can back it with transparent huge pages.
+inline void* mapAlignedAnonymous(size_t bytes) {
+    size_t padded = bytes + kHugePageSize;
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return nullptr;
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + kHugePageSize - 1) & ~(uintptr_t(kHugePageSize) - 1);
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    uintptr_t end = start + padded;
+    if (end > aligned + bytes) {
+        munmap(reinterpret_cast<void*>(aligned + bytes), end - (aligned + bytes));
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+
+// Maps anonymous memory, trying the requested huge page mode first and
+// degrading Explicit -> Transparent -> Off. `backing` reports what was used.
+inline PageMapping mapPages(size_t bytes, HugePageMode mode) {
+    PageMapping mapping;
+    if (mode == HugePageMode::Explicit) {
+        size_t size = roundUpTo(bytes, kHugePageSize);
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            return PageMapping{ptr, size, HugePageMode::Explicit};
+        }
+        mode = HugePageMode::Transparent;
+    }
+    if (mode == HugePageMode::Transparent) {
+        size_t size = roundUpTo(bytes, kHugePageSize);
+        void* ptr = mapAlignedAnonymous(size);
+        if (ptr != nullptr) {
+            bool advised = madvise(ptr, size, MADV_HUGEPAGE) == 0;
+            return PageMapping{ptr, size, advised ? HugePageMode::Transparent : HugePageMode::Off};
+        }
+    }
+    size_t size = roundUpTo(bytes, 4096);
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr != MAP_FAILED) {
+        mapping = PageMapping{ptr, size, HugePageMode::Off};
+    }
+    return mapping;
+}
+
+inline void unmapPages(const PageMapping& mapping) {
+    if (mapping.ptr != nullptr) {
+        munmap(mapping.ptr, mapping.size);
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <ostream>
+
+inline uint64_t realtimeNs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+inline uint64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Fixed-size log-linear histogram (HdrHistogram layout with 32 sub-buckets
+// per power of two, ~3% relative precision) covering 0 ns .. ~18 minutes.
+// Recording is a couple of shifts and an increment with no allocation.
+// Not thread-safe: keep one per writer and merge() for reporting.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+    static constexpr int kMaxShift = 35;
+    static constexpr size_t kBucketCount = 2 * kSubBuckets + kMaxShift * kSubBuckets;
+
+    void record(uint64_t value) {
+        counts[indexFor(value)]++;
+        total++;
+        sum += value;
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+        sum += other.sum;
+        min_value = std::min(min_value, other.min_value);
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    void reset() { *this = LatencyHistogram(); }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total == 0 ? 0 : min_value; }
+    uint64_t max() const { return max_value; }
+    double mean() const { return total == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(total); }
+
+    // Upper edge of the bucket holding the given percentile (0..100].
+    uint64_t valueAtPercentile(double percentile) const {
+        if (total == 0) {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5);
+        rank = std::clamp<uint64_t>(rank, 1, total);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(highestEquivalent(i), max_value);
+            }
+        }
+        return max_value;
+    }
+
+    // One-line summary in microseconds.
+    void print(std::ostream& out, const char* prefix, const char* label) const {
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        out << prefix << " " << label << " latency (us): n=" << total << std::fixed << std::setprecision(1);
+        if (total > 0) {
+            out << " min=" << us(min()) << " p50=" << us(valueAtPercentile(50)) << " p90=" << us(valueAtPercentile(90))
+                << " p99=" << us(valueAtPercentile(99)) << " p99.9=" << us(valueAtPercentile(99.9))
+                << " max=" << us(max()) << " mean=" << mean() / 1000.0;
+        }
+        out << std::endl;
+    }
+
+private:
+    static size_t indexFor(uint64_t value) {
+        if (value < 2 * kSubBuckets) {
+            return static_cast<size_t>(value);
+        }
+        int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+        if (shift > kMaxShift) {
+            return kBucketCount - 1;
+        }
+        uint64_t sub = (value >> shift) - kSubBuckets;
+        return static_cast<size_t>(2 * kSubBuckets + (shift - 1) * kSubBuckets + sub);
+    }
+
+    static uint64_t highestEquivalent(size_t index) {
+        if (index < 2 * kSubBuckets) {
+            return index;
+        }
+        int shift = static_cast<int>((index - 2 * kSubBuckets) / kSubBuckets) + 1;
+        uint64_t sub = (index - 2 * kSubBuckets) % kSubBuckets + kSubBuckets;
+        return (sub << shift) + (uint64_t(1) << shift) - 1;
+    }
+
+    uint64_t counts[kBucketCount] = {};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t min_value = UINT64_MAX;
+    uint64_t max_value = 0;
+};
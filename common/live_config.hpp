@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+// RCU-style holder for settings that change at runtime. Readers get the
+// current snapshot with a single acquire load, no lock and no reference
+// count; a writer publishes a complete new snapshot with one pointer swap,
+// so readers never see a half-applied change. Replaced snapshots are kept
+// until the holder is destroyed instead of waiting for a grace period:
+// reloads are operator actions, so this costs one small struct per reload.
+template <typename T>
+class RcuSnapshot {
+public:
+    explicit RcuSnapshot(T initial) {
+        snapshots.push_back(std::make_unique<const T>(std::move(initial)));
+        current.store(snapshots.back().get(), std::memory_order_release);
+    }
+
+    RcuSnapshot(const RcuSnapshot&) = delete;
+    RcuSnapshot& operator=(const RcuSnapshot&) = delete;
+
+    // Valid for the holder's lifetime; read again to observe later updates.
+    const T& read() const { return *current.load(std::memory_order_acquire); }
+
+    void publish(T next) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        snapshots.push_back(std::make_unique<const T>(std::move(next)));
+        current.store(snapshots.back().get(), std::memory_order_release);
+        published.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Number of publish() calls since construction.
+    uint64_t version() const { return published.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<const T*> current{nullptr};
+    std::atomic<uint64_t> published{0};
+    std::mutex writer_mutex;
+    std::vector<std::unique_ptr<const T>> snapshots;
+};
+
+// Runs `on_reload` on its own thread whenever the process receives SIGHUP.
+// The constructor blocks SIGHUP in the calling thread, so create it in
+// main() before starting other threads: they inherit the mask and the
+// signal is only ever consumed here, never by the default handler (which
+// would terminate the process).
+class ReloadSignal {
+public:
+    explicit ReloadSignal(std::function<void()> on_reload) : on_reload(std::move(on_reload)) {
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGHUP);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    }
+
+    ~ReloadSignal() { stop(); }
+
+    ReloadSignal(const ReloadSignal&) = delete;
+    ReloadSignal& operator=(const ReloadSignal&) = delete;
+
+    void start() {
+        running.store(true, std::memory_order_release);
+        waiter = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        if (!waiter.joinable()) {
+            return;
+        }
+        running.store(false, std::memory_order_release);
+        waiter.join();
+    }
+
+private:
+    void run() {
+        const timespec poll_interval{0, 200'000'000};
+        while (running.load(std::memory_order_acquire)) {
+            if (sigtimedwait(&signals, nullptr, &poll_interval) == SIGHUP) {
+                on_reload();
+            }
+        }
+    }
+
+    std::function<void()> on_reload;
+    sigset_t signals;
+    std::thread waiter;
+    std::atomic<bool> running{false};
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string_view>
+
+// Verbosity of the per-message and diagnostic output. Errors always print.
+enum class LogLevel {
+    Debug,
+    Info,   // one line per message sent/received
+    Warn,   // summaries and problems only
+    Error,
+};
+
+inline const char* logLevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Warn: return "warn";
+        case LogLevel::Error: return "error";
+        default: return "info";
+    }
+}
+
+inline bool parseLogLevel(std::string_view text, LogLevel& level) {
+    if (text == "debug") {
+        level = LogLevel::Debug;
+    } else if (text == "info") {
+        level = LogLevel::Info;
+    } else if (text == "warn" || text == "warning") {
+        level = LogLevel::Warn;
+    } else if (text == "error") {
+        level = LogLevel::Error;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Opens one user-space-only counter for the calling thread; -1 on failure.
+inline int openPerfEvent(uint32_t type, uint64_t config, int group_fd = -1, uint64_t read_format = 0) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = read_format;
+    // Group members follow the leader's enable/disable
+    attr.disabled = group_fd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// Thin wrapper over one perf_event_open(2) counter for the calling thread.
+// Counters are frequently unavailable in containers (perf_event_paranoid,
+// seccomp); callers must check valid() and report "n/a" instead of failing.
+class PerfCounter {
+public:
+    PerfCounter(uint32_t type, uint64_t config) : fd(openPerfEvent(type, config)) {}
+
+    static PerfCounter dtlbLoadMisses() {
+        return PerfCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    }
+
+    static PerfCounter dtlbStoreMisses() {
+        return PerfCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_WRITE << 8) |
+                                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    }
+
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+    PerfCounter(PerfCounter&& other) noexcept : fd(other.fd) { other.fd = -1; }
+
+    ~PerfCounter() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    bool valid() const { return fd >= 0; }
+
+    void start() {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    void stop() {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    uint64_t read() const {
+        uint64_t value = 0;
+        if (fd < 0 || ::read(fd, &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value))) {
+            return 0;
+        }
+        return value;
+    }
+
+private:
+    int fd = -1;
+};
+
+enum class PerfEvent { Cycles, Instructions, CacheMisses, BranchMisses };
+
+constexpr size_t kPerfEventCount = 4;
+
+inline const char* perfEventName(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::Cycles: return "cycles";
+        case PerfEvent::Instructions: return "instructions";
+        case PerfEvent::CacheMisses: return "cache-misses";
+        case PerfEvent::BranchMisses: return "branch-misses";
+    }
+    return "unknown";
+}
+
+// Counts from one PerfCounterGroup run. Hardware values are scaled up when
+// the kernel had to multiplex the group; `multiplexed` says so.
+struct PerfSample {
+    uint64_t values[kPerfEventCount] = {};
+    bool valid[kPerfEventCount] = {};
+    uint64_t context_switches = 0;  // voluntary + involuntary
+    bool multiplexed = false;
+
+    bool has(PerfEvent event) const { return valid[static_cast<size_t>(event)]; }
+    uint64_t value(PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+
+    double perMessage(PerfEvent event, uint64_t messages) const {
+        return messages > 0 ? static_cast<double>(value(event)) / static_cast<double>(messages) : 0.0;
+    }
+
+    // Instructions per cycle; 0 when either counter is missing
+    double ipc() const {
+        return has(PerfEvent::Cycles) && has(PerfEvent::Instructions) && value(PerfEvent::Cycles) > 0
+                   ? static_cast<double>(value(PerfEvent::Instructions)) / static_cast<double>(value(PerfEvent::Cycles))
+                   : 0.0;
+    }
+};
+
+// Cycles, instructions, cache misses and branch misses for the calling
+// thread, opened as one perf group so they cover exactly the same interval
+// and the ratios between them are meaningful. Events the CPU or the
+// container does not allow are left out; context switches come from
+// getrusage(), which needs no permission.
+class PerfCounterGroup {
+public:
+    PerfCounterGroup() {
+        static constexpr struct {
+            PerfEvent event;
+            uint64_t config;
+        } kEvents[] = {
+            {PerfEvent::Cycles, PERF_COUNT_HW_CPU_CYCLES},
+            {PerfEvent::Instructions, PERF_COUNT_HW_INSTRUCTIONS},
+            {PerfEvent::CacheMisses, PERF_COUNT_HW_CACHE_MISSES},
+            {PerfEvent::BranchMisses, PERF_COUNT_HW_BRANCH_MISSES},
+        };
+        const uint64_t read_format =
+            PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        for (const auto& spec : kEvents) {
+            // The first event that opens leads the group
+            int fd = openPerfEvent(PERF_TYPE_HARDWARE, spec.config, count > 0 ? fds[0] : -1, read_format);
+            if (fd >= 0) {
+                fds[count] = fd;
+                order[count++] = spec.event;
+            }
+        }
+    }
+
+    ~PerfCounterGroup() {
+        for (size_t i = count; i-- > 0;) {
+            close(fds[i]);
+        }
+    }
+
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+    // True when at least one hardware counter opened.
+    bool valid() const { return count > 0; }
+
+    void start() {
+        switches_at_start = contextSwitches();
+        if (count > 0) {
+            ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void stop() {
+        if (count > 0) {
+            ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+        switches_at_stop = contextSwitches();
+    }
+
+    PerfSample read() const {
+        PerfSample sample;
+        sample.context_switches = switches_at_stop - switches_at_start;
+        // nr, time_enabled, time_running, then one value per event
+        uint64_t data[3 + kPerfEventCount] = {};
+        if (count == 0 || ::read(fds[0], data, sizeof(data)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+            return sample;
+        }
+        uint64_t enabled = data[1];
+        uint64_t running = data[2];
+        if (running == 0) {
+            return sample;  // the group never got onto the PMU
+        }
+        sample.multiplexed = running < enabled;
+        double scale = static_cast<double>(enabled) / static_cast<double>(running);
+        for (size_t i = 0; i < data[0] && i < count; ++i) {
+            size_t index = static_cast<size_t>(order[i]);
+            sample.values[index] = static_cast<uint64_t>(static_cast<double>(data[3 + i]) * scale);
+            sample.valid[index] = true;
+        }
+        return sample;
+    }
+
+private:
+    static uint64_t contextSwitches() {
+        rusage usage;
+        if (getrusage(RUSAGE_THREAD, &usage) != 0) {
+            return 0;
+        }
+        return static_cast<uint64_t>(usage.ru_nvcsw) + static_cast<uint64_t>(usage.ru_nivcsw);
+    }
+
+    int fds[kPerfEventCount] = {};   // fds[0] is the group leader
+    PerfEvent order[kPerfEventCount] = {};
+    size_t count = 0;
+    uint64_t switches_at_start = 0;
+    uint64_t switches_at_stop = 0;
+};
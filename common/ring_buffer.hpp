@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+#include "huge_pages.hpp"
+
+// Byte ring buffer whose storage is mapped twice back to back, so the region
+// [readPtr(), readPtr() + readable()) is always contiguous in virtual memory
+// even when it wraps around the end of the buffer. Frames that straddle the
+// wrap point can therefore be parsed and viewed in place without memmove.
+class MirroredRingBuffer {
+public:
+    MirroredRingBuffer() = default;
+
+    MirroredRingBuffer(const MirroredRingBuffer&) = delete;
+    MirroredRingBuffer& operator=(const MirroredRingBuffer&) = delete;
+
+    MirroredRingBuffer(MirroredRingBuffer&& other) noexcept { *this = std::move(other); }
+
+    MirroredRingBuffer& operator=(MirroredRingBuffer&& other) noexcept {
+        if (this != &other) {
+            release();
+            base = std::exchange(other.base, nullptr);
+            size = std::exchange(other.size, 0);
+            head = std::exchange(other.head, 0);
+            tail = std::exchange(other.tail, 0);
+            backing = std::exchange(other.backing, HugePageMode::Off);
+        }
+        return *this;
+    }
+
+    ~MirroredRingBuffer() { release(); }
+
+    // Maps at least `min_capacity` bytes, rounded up to a power-of-two page
+    // multiple. Explicit mode backs the ring with hugetlbfs pages; Transparent
+    // aligns both views to 2 MB and advises THP for the shmem object. Either
+    // falls back to normal pages if the kernel refuses.
+    bool allocate(size_t min_capacity, HugePageMode mode) {
+        release();
+        if (mode == HugePageMode::Explicit && map(roundUp(min_capacity, kHugePageSize), HugePageMode::Explicit)) {
+            return true;
+        }
+        if (mode != HugePageMode::Off && map(roundUp(min_capacity, kHugePageSize), HugePageMode::Transparent)) {
+            return true;
+        }
+        return map(roundUp(min_capacity, static_cast<size_t>(sysconf(_SC_PAGESIZE))), HugePageMode::Off);
+    }
+
+    bool valid() const { return base != nullptr; }
+    size_t capacity() const { return size; }
+    HugePageMode backingPages() const { return backing; }
+
+    char* readPtr() const { return base + (head & (size - 1)); }
+    size_t readable() const { return static_cast<size_t>(tail - head); }
+    void consume(size_t bytes) { head += bytes; }
+
+    char* writePtr() const { return base + (tail & (size - 1)); }
+    size_t writable() const { return size - readable(); }
+    void commit(size_t bytes) { tail += bytes; }
+
+    void clear() { head = tail = 0; }
+
+private:
+    static size_t roundUp(size_t value, size_t multiple) {
+        size_t rounded = (value + multiple - 1) / multiple * multiple;
+        // Positions are reduced with a mask, so keep the capacity a power of two.
+        size_t pow2 = multiple;
+        while (pow2 < rounded) {
+            pow2 <<= 1;
+        }
+        return pow2;
+    }
+
+    bool map(size_t capacity, HugePageMode mode) {
+        unsigned int flags = MFD_CLOEXEC | (mode == HugePageMode::Explicit ? MFD_HUGETLB : 0u);
+        int fd = memfd_create("stomp-ring", flags);
+        if (fd < 0) {
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(capacity)) != 0) {
+            close(fd);
+            return false;
+        }
+
+        // Reserve 2x the address space (2 MB aligned so either view can be
+        // huge-page backed), then map the same file over both halves.
+        size_t padded = capacity * 2 + kHugePageSize;
+        void* reserved = mmap(nullptr, padded, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reserved == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        uintptr_t start = reinterpret_cast<uintptr_t>(reserved);
+        uintptr_t aligned = (start + kHugePageSize - 1) & ~(uintptr_t(kHugePageSize) - 1);
+        if (aligned > start) {
+            munmap(reserved, aligned - start);
+        }
+        munmap(reinterpret_cast<void*>(aligned + capacity * 2), start + padded - (aligned + capacity * 2));
+
+        char* first = reinterpret_cast<char*>(aligned);
+        bool mapped =
+            mmap(first, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED &&
+            mmap(first + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+        close(fd);
+        if (!mapped) {
+            munmap(first, capacity * 2);
+            return false;
+        }
+        if (mode == HugePageMode::Transparent && madvise(first, capacity * 2, MADV_HUGEPAGE) != 0) {
+            munmap(first, capacity * 2);
+            return false;
+        }
+
+        base = first;
+        size = capacity;
+        backing = mode;
+        head = tail = 0;
+        return true;
+    }
+
+    void release() {
+        if (base != nullptr) {
+            munmap(base, size * 2);
+        }
+        base = nullptr;
+        size = 0;
+        head = tail = 0;
+        backing = HugePageMode::Off;
+    }
+
+    char* base = nullptr;
+    size_t size = 0;
+    uint64_t head = 0;
+    uint64_t tail = 0;
+    HugePageMode backing = HugePageMode::Off;
+};
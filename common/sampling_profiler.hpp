@@ -0,0 +1,324 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/prctl.h>
+#include <sys/time.h>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "admin_server.hpp"
+
+// One stack captured by the SIGPROF handler. `depth` is stored last, so a
+// non-zero depth means the slot is complete.
+struct ProfileSample {
+    static constexpr int kMaxDepth = 48;
+
+    std::atomic<int> depth{0};
+    char thread[16];
+    void* frames[kMaxDepth];
+};
+
+// In-process CPU sampling profiler for when perf cannot be attached.
+// ITIMER_PROF sends SIGPROF every 1/hz seconds of process CPU time to a
+// thread that is running; the handler appends that thread's stack to a
+// preallocated array with one fetch_add and never locks or allocates. When
+// the run ends, a background thread symbolizes the stacks into the folded
+// format flamegraph.pl and speedscope read ("thread;outer;...;leaf count").
+//
+// Each sample costs a few microseconds of unwinding, so 100 Hz stays well
+// under 1% of a core. Idle threads are not sampled, and neither is time off
+// the CPU. Function names need the binary linked with -rdynamic (the CMake
+// files set ENABLE_EXPORTS); otherwise frames show as module+offset.
+class SamplingProfiler {
+public:
+    static SamplingProfiler& instance() {
+        static SamplingProfiler profiler;
+        return profiler;
+    }
+
+    ~SamplingProfiler() { stop(); }
+
+    // Starts a run of `duration` at `hz`; false (with `error`) if one is
+    // already running or the timer cannot be armed.
+    bool start(std::chrono::seconds duration, int hz, size_t capacity, std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running) {
+            error = "a profile is already running";
+            return false;
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+        warmUp();
+        buffer = std::make_unique<ProfileSample[]>(capacity);
+        sample_capacity = capacity;
+        next.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+        samples.store(buffer.get(), std::memory_order_release);
+
+        itimerval timer{};
+        timer.it_interval.tv_usec = std::max(1, 1'000'000 / std::clamp(hz, 1, 1000));
+        timer.it_value = timer.it_interval;
+        if (!installHandler() || setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+            error = std::string("cannot arm the profiling timer: ") + std::strerror(errno);
+            samples.store(nullptr, std::memory_order_release);
+            return false;
+        }
+        running = true;
+        cancelled = false;
+        deadline = std::chrono::steady_clock::now() + duration;
+        worker = std::thread([this] { finish(); });
+        return true;
+    }
+
+    // Ends a run early; its samples are still folded.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    bool isRunning() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return running;
+    }
+
+    // Seconds left in the current run, 0 when idle.
+    int64_t secondsLeft() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) {
+            return 0;
+        }
+        auto left = std::chrono::ceil<std::chrono::seconds>(deadline - std::chrono::steady_clock::now());
+        return std::max<int64_t>(0, left.count());
+    }
+
+    // Folded stacks of the last finished run, busiest first.
+    std::string folded() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return result;
+    }
+
+    uint64_t sampleCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return result_samples;
+    }
+
+    uint64_t droppedCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return result_dropped;
+    }
+
+private:
+    SamplingProfiler() = default;
+
+    // Installed on the first run and never removed: a SIGPROF generated just
+    // before the timer is disarmed can still arrive afterwards, and the
+    // default action would kill the process. With `samples` cleared the
+    // handler does nothing.
+    bool installHandler() {
+        if (handler_installed) {
+            return true;
+        }
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = onSignal;
+        action.sa_flags = SA_RESTART | SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        handler_installed = sigaction(SIGPROF, &action, nullptr) == 0;
+        return handler_installed;
+    }
+
+    // backtrace() loads libgcc on first use, which is not signal safe
+    static void warmUp() {
+        void* frames[2];
+        backtrace(frames, 2);
+    }
+
+    static void onSignal(int, siginfo_t*, void*) {
+        int saved_errno = errno;
+        SamplingProfiler& self = instance();
+        // seq_cst pairs with finish(): it clears `samples`, then waits for in_flight
+        self.in_flight.fetch_add(1);
+        ProfileSample* base = self.samples.load();
+        if (base != nullptr) {
+            size_t index = self.next.fetch_add(1, std::memory_order_relaxed);
+            if (index < self.sample_capacity) {
+                ProfileSample& sample = base[index];
+                // PR_GET_NAME is one syscall; pthread_getname_np may open /proc
+                prctl(PR_GET_NAME, sample.thread, 0, 0, 0);
+                int depth = backtrace(sample.frames, ProfileSample::kMaxDepth);
+                sample.depth.store(depth > 0 ? depth : 1, std::memory_order_release);
+            } else {
+                self.dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        self.in_flight.fetch_sub(1);
+        errno = saved_errno;
+    }
+
+    void finish() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_until(lock, deadline, [this] { return cancelled; });
+        }
+        itimerval off{};
+        setitimer(ITIMER_PROF, &off, nullptr);
+        samples.store(nullptr);
+        // A handler that loaded `samples` before the store may still be writing
+        while (in_flight.load() != 0) {
+            std::this_thread::yield();
+        }
+
+        size_t count = std::min(next.load(std::memory_order_relaxed), sample_capacity);
+        std::string text = fold(buffer.get(), count);
+        buffer.reset();
+        std::lock_guard<std::mutex> lock(mutex);
+        result = std::move(text);
+        result_samples = count;
+        result_dropped = dropped.load(std::memory_order_relaxed);
+        running = false;
+    }
+
+    static std::string symbolize(void* address, bool leaf) {
+        // A return address points after the call; step back into it
+        void* lookup = leaf ? address : static_cast<char*>(address) - 1;
+        Dl_info info;
+        if (dladdr(lookup, &info) == 0) {
+            char hex[32];
+            std::snprintf(hex, sizeof(hex), "%p", address);
+            return hex;
+        }
+        if (info.dli_sname != nullptr) {
+            int status = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            std::string name = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+            std::free(demangled);
+            // ';' separates frames in the folded format
+            std::replace(name.begin(), name.end(), ';', ':');
+            return name;
+        }
+        std::string module = info.dli_fname != nullptr ? info.dli_fname : "?";
+        module = module.substr(module.rfind('/') + 1);
+        char offset[32];
+        std::snprintf(offset, sizeof(offset), "+0x%zx",
+                      static_cast<size_t>(static_cast<char*>(lookup) - static_cast<char*>(info.dli_fbase)));
+        return module + offset;
+    }
+
+    // Frames 0 and 1 are this handler and the kernel's signal trampoline.
+    static std::string fold(const ProfileSample* base, size_t count) {
+        constexpr int kSkip = 2;
+        std::unordered_map<void*, std::string> names;
+        std::map<std::string, uint64_t> stacks;
+        std::string stack;
+        for (size_t i = 0; i < count; ++i) {
+            const ProfileSample& sample = base[i];
+            int depth = sample.depth.load(std::memory_order_acquire);
+            if (depth == 0) {
+                continue;
+            }
+            stack.assign(sample.thread, strnlen(sample.thread, sizeof(sample.thread)));
+            for (int frame = depth - 1; frame >= kSkip; --frame) {
+                auto it = names.find(sample.frames[frame]);
+                if (it == names.end()) {
+                    it = names.emplace(sample.frames[frame], symbolize(sample.frames[frame], frame == kSkip)).first;
+                }
+                stack.push_back(';');
+                stack.append(it->second);
+            }
+            ++stacks[stack];
+        }
+
+        std::vector<std::pair<std::string, uint64_t>> sorted(stacks.begin(), stacks.end());
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const auto& a, const auto& b) { return a.second > b.second; });
+        std::string out;
+        for (const auto& [frames, hits] : sorted) {
+            out.append(frames).push_back(' ');
+            out.append(std::to_string(hits)).push_back('\n');
+        }
+        return out;
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread worker;
+    bool running = false;
+    bool cancelled = false;
+    std::chrono::steady_clock::time_point deadline;
+    bool handler_installed = false;
+    std::unique_ptr<ProfileSample[]> buffer;
+    std::string result;
+    uint64_t result_samples = 0;
+    uint64_t result_dropped = 0;
+
+    // Shared with the signal handler
+    std::atomic<ProfileSample*> samples{nullptr};
+    size_t sample_capacity = 0;
+    std::atomic<size_t> next{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<int> in_flight{0};
+};
+
+// POST /profile/start?seconds=30&hz=100 starts a run; GET /profile returns the
+// folded stacks of the last finished one.
+inline void addProfileRoutes(AdminServer& admin, size_t capacity) {
+    auto number = [](std::string_view text, int fallback, int low, int high, int& out) {
+        out = fallback;
+        if (text.empty()) {
+            return true;
+        }
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+        return ec == std::errc() && end == text.data() + text.size() && out >= low && out <= high;
+    };
+    admin.route("POST", "/profile/start", [=](const AdminRequest& request) {
+        int seconds = 0;
+        int hz = 0;
+        if (!number(request.param("seconds"), 30, 1, 3600, seconds) || !number(request.param("hz"), 100, 1, 1000, hz)) {
+            return AdminResponse{400, "text/plain", "expected seconds=1..3600 and hz=1..1000\n"};
+        }
+        std::string error;
+        if (!SamplingProfiler::instance().start(std::chrono::seconds(seconds), hz, capacity, error)) {
+            return AdminResponse{409, "text/plain", error + "\n"};
+        }
+        return AdminResponse{200, "text/plain",
+                             "profiling for " + std::to_string(seconds) + " s at " + std::to_string(hz) +
+                                 " Hz; GET /profile when done\n"};
+    });
+    admin.route("GET", "/profile", [](const AdminRequest&) {
+        SamplingProfiler& profiler = SamplingProfiler::instance();
+        if (profiler.isRunning()) {
+            return AdminResponse{503, "text/plain",
+                                 "profiling, " + std::to_string(profiler.secondsLeft()) + " s left\n"};
+        }
+        if (profiler.sampleCount() == 0 && profiler.droppedCount() == 0) {
+            return AdminResponse{404, "text/plain", "no profile yet; POST /profile/start to start one\n"};
+        }
+        return AdminResponse{200, "text/plain", profiler.folded()};
+    });
+}
@@ -0,0 +1,839 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "stomp_frame.hpp"
+
+// Value on the selector evaluation stack. Header values are strings and are
+// converted to numbers or booleans when compared with one; Null doubles as
+// SQL's UNKNOWN truth value.
+struct SelectorValue {
+    enum class Type : uint8_t { Null, Bool, Number, String };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string_view text;
+
+    static SelectorValue null() { return SelectorValue{}; }
+    static SelectorValue of(bool value) { return SelectorValue{Type::Bool, value, 0, {}}; }
+    static SelectorValue of(double value) { return SelectorValue{Type::Number, false, value, {}}; }
+    static SelectorValue of(std::string_view value) { return SelectorValue{Type::String, false, 0, value}; }
+};
+
+// JMS message selector (the SQL-92 subset from the JMS spec) compiled to a
+// small stack bytecode:
+//
+//   priority > 4 AND type IN ('order', 'refund') AND region LIKE 'eu-%'
+//
+// Supports =, <>, <, <=, >, >=, + - * /, AND/OR/NOT with three-valued
+// logic, [NOT] BETWEEN, [NOT] IN, [NOT] LIKE ... [ESCAPE], IS [NOT] NULL,
+// string/number/boolean literals and header identifiers. JMS header names
+// (JMSPriority, JMSMessageID, ...) map to their STOMP headers. Identifiers
+// may contain '-' so STOMP names such as correlation-id work; write
+// subtraction with spaces ("a - b").
+//
+// The same expression string can be sent to the broker as the SUBSCRIBE
+// `selector` header; matches() evaluates it locally for brokers (or
+// destinations) that do not filter. Evaluation uses a fixed-size stack and
+// never allocates, and matches() is const so one Selector can be shared
+// between threads.
+class Selector {
+public:
+    static constexpr size_t kMaxStack = 32;
+
+    Selector() = default;
+
+    // Returns false and fills `error` if the expression does not parse.
+    bool compile(std::string_view selector_expression, std::string& error) {
+        source = selector_expression;
+        code.clear();
+        pool.clear();
+        in_lists.clear();
+        depth = 0;
+        max_depth = 0;
+        compiled = false;
+
+        Parser parser(*this, source);
+        if (!parser.parse(error)) {
+            code.clear();
+            return false;
+        }
+        if (max_depth > kMaxStack) {
+            error = "expression nests too deeply";
+            code.clear();
+            return false;
+        }
+        compiled = true;
+        return true;
+    }
+
+    bool valid() const { return compiled; }
+    const std::string& expression() const { return source; }
+    size_t instructionCount() const { return code.size(); }
+
+    // True only if the selector evaluates to TRUE (UNKNOWN does not match).
+    // An empty (never compiled) selector matches everything.
+    bool matches(const StompFrameView& frame) const {
+        if (!compiled) {
+            return true;
+        }
+        SelectorValue result = evaluate(frame);
+        return result.type == SelectorValue::Type::Bool && result.boolean;
+    }
+
+    SelectorValue evaluate(const StompFrameView& frame) const {
+        // Left uninitialized: zeroing 32 slots costs more than a short program
+        union Slots {
+            SelectorValue values[kMaxStack];
+            Slots() {}
+        } slots;
+        SelectorValue* stack = slots.values;
+        size_t top = 0;  // number of live entries
+        for (size_t pc = 0; pc < code.size(); ++pc) {
+            const Instruction& in = code[pc];
+            switch (in.op) {
+                case Op::PushNull: stack[top++] = SelectorValue::null(); break;
+                case Op::PushBool: stack[top++] = SelectorValue::of(in.a != 0); break;
+                case Op::PushNumber: stack[top++] = SelectorValue::of(in.number); break;
+                case Op::PushString: stack[top++] = SelectorValue::of(text(in.a, in.b)); break;
+                case Op::Load: {
+                    const StompHeader* header = frame.findHeader(text(in.a, in.b));
+                    stack[top++] = header != nullptr ? SelectorValue::of(header->value) : SelectorValue::null();
+                    break;
+                }
+                case Op::Eq: case Op::Ne: case Op::Lt: case Op::Le: case Op::Gt: case Op::Ge:
+                    --top;
+                    stack[top - 1] = compare(in.op, stack[top - 1], stack[top]);
+                    break;
+                case Op::Add: case Op::Sub: case Op::Mul: case Op::Div:
+                    --top;
+                    stack[top - 1] = arithmetic(in.op, stack[top - 1], stack[top]);
+                    break;
+                case Op::Neg: {
+                    double value = 0;
+                    stack[top - 1] = toNumber(stack[top - 1], value) ? SelectorValue::of(-value) : SelectorValue::null();
+                    break;
+                }
+                case Op::Not: {
+                    SelectorValue value = toBool(stack[top - 1]);
+                    stack[top - 1] = value.type == SelectorValue::Type::Null ? value : SelectorValue::of(!value.boolean);
+                    break;
+                }
+                case Op::And:
+                    --top;
+                    stack[top - 1] = logicalAnd(stack[top - 1], stack[top]);
+                    break;
+                case Op::Or:
+                    --top;
+                    stack[top - 1] = logicalOr(stack[top - 1], stack[top]);
+                    break;
+                case Op::JumpIfFalse: {
+                    SelectorValue value = toBool(stack[top - 1]);
+                    if (value.type == SelectorValue::Type::Bool && !value.boolean) {
+                        stack[top - 1] = value;
+                        pc = in.a - 1;
+                    }
+                    break;
+                }
+                case Op::JumpIfTrue: {
+                    SelectorValue value = toBool(stack[top - 1]);
+                    if (value.type == SelectorValue::Type::Bool && value.boolean) {
+                        stack[top - 1] = value;
+                        pc = in.a - 1;
+                    }
+                    break;
+                }
+                case Op::Between: {
+                    top -= 2;
+                    SelectorValue low = compare(Op::Ge, stack[top - 1], stack[top]);
+                    SelectorValue high = compare(Op::Le, stack[top - 1], stack[top + 1]);
+                    stack[top - 1] = negateIf(logicalAnd(low, high), in.negate);
+                    break;
+                }
+                case Op::In: {
+                    const SelectorValue& value = stack[top - 1];
+                    if (value.type != SelectorValue::Type::String) {
+                        stack[top - 1] = SelectorValue::null();
+                        break;
+                    }
+                    bool found = false;
+                    for (uint32_t i = in.a; i < in.a + in.b && !found; ++i) {
+                        found = value.text == text(in_lists[i].first, in_lists[i].second);
+                    }
+                    stack[top - 1] = SelectorValue::of(found != in.negate);
+                    break;
+                }
+                case Op::Like: {
+                    const SelectorValue& value = stack[top - 1];
+                    if (value.type != SelectorValue::Type::String) {
+                        stack[top - 1] = SelectorValue::null();
+                        break;
+                    }
+                    stack[top - 1] = SelectorValue::of(likeMatch(value.text, text(in.a, in.b)) != in.negate);
+                    break;
+                }
+                case Op::IsNull:
+                    stack[top - 1] = SelectorValue::of((stack[top - 1].type == SelectorValue::Type::Null) != in.negate);
+                    break;
+            }
+        }
+        return top == 1 ? toBool(stack[0]) : SelectorValue::null();
+    }
+
+private:
+    enum class Op : uint8_t {
+        PushNull, PushBool, PushNumber, PushString, Load,
+        Eq, Ne, Lt, Le, Gt, Ge,
+        Add, Sub, Mul, Div, Neg,
+        Not, And, Or, JumpIfFalse, JumpIfTrue,
+        Between, In, Like, IsNull,
+    };
+
+    struct Instruction {
+        Op op;
+        bool negate = false;
+        uint32_t a = 0;  // pool offset, jump target or in-list start
+        uint32_t b = 0;  // pool length or in-list size
+        double number = 0;
+    };
+
+    // LIKE patterns are stored with their wildcards replaced by these bytes,
+    // so ESCAPE is resolved once at compile time.
+    static constexpr char kAnySequence = '\x01';
+    static constexpr char kAnyChar = '\x02';
+
+    std::string_view text(uint32_t offset, uint32_t length) const {
+        return std::string_view(pool.data() + offset, length);
+    }
+
+    std::pair<uint32_t, uint32_t> intern(std::string_view value) {
+        std::pair<uint32_t, uint32_t> slot(static_cast<uint32_t>(pool.size()), static_cast<uint32_t>(value.size()));
+        pool.append(value);
+        return slot;
+    }
+
+    size_t emit(Instruction instruction) {
+        static const int8_t kStackEffect[] = {
+            1, 1, 1, 1, 1,           // pushes and loads
+            -1, -1, -1, -1, -1, -1,  // comparisons
+            -1, -1, -1, -1, 0,       // arithmetic
+            0, -1, -1, 0, 0,         // logic and jumps
+            -2, 0, 0, 0,             // predicates
+        };
+        depth += kStackEffect[static_cast<size_t>(instruction.op)];
+        max_depth = std::max(max_depth, static_cast<size_t>(std::max(depth, 0)));
+        code.push_back(instruction);
+        return code.size() - 1;
+    }
+
+    static bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool toNumber(const SelectorValue& value, double& out) {
+        if (value.type == SelectorValue::Type::Number) {
+            out = value.number;
+            return true;
+        }
+        if (value.type == SelectorValue::Type::String && !value.text.empty()) {
+            const char* end = value.text.data() + value.text.size();
+            auto result = std::from_chars(value.text.data(), end, out);
+            return result.ec == std::errc() && result.ptr == end;
+        }
+        return false;
+    }
+
+    static SelectorValue toBool(const SelectorValue& value) {
+        if (value.type == SelectorValue::Type::Bool) {
+            return value;
+        }
+        if (value.type == SelectorValue::Type::String) {
+            if (equalsIgnoreCase(value.text, "true")) {
+                return SelectorValue::of(true);
+            }
+            if (equalsIgnoreCase(value.text, "false")) {
+                return SelectorValue::of(false);
+            }
+        }
+        return SelectorValue::null();
+    }
+
+    static SelectorValue negateIf(const SelectorValue& value, bool negate) {
+        if (!negate || value.type != SelectorValue::Type::Bool) {
+            return value;
+        }
+        return SelectorValue::of(!value.boolean);
+    }
+
+    static SelectorValue logicalAnd(const SelectorValue& left, const SelectorValue& right) {
+        SelectorValue l = toBool(left);
+        SelectorValue r = toBool(right);
+        if ((l.type == SelectorValue::Type::Bool && !l.boolean) || (r.type == SelectorValue::Type::Bool && !r.boolean)) {
+            return SelectorValue::of(false);
+        }
+        if (l.type == SelectorValue::Type::Bool && r.type == SelectorValue::Type::Bool) {
+            return SelectorValue::of(true);
+        }
+        return SelectorValue::null();
+    }
+
+    static SelectorValue logicalOr(const SelectorValue& left, const SelectorValue& right) {
+        SelectorValue l = toBool(left);
+        SelectorValue r = toBool(right);
+        if ((l.type == SelectorValue::Type::Bool && l.boolean) || (r.type == SelectorValue::Type::Bool && r.boolean)) {
+            return SelectorValue::of(true);
+        }
+        if (l.type == SelectorValue::Type::Bool && r.type == SelectorValue::Type::Bool) {
+            return SelectorValue::of(false);
+        }
+        return SelectorValue::null();
+    }
+
+    template <typename T>
+    static SelectorValue ordered(Op op, const T& l, const T& r) {
+        switch (op) {
+            case Op::Eq: return SelectorValue::of(l == r);
+            case Op::Ne: return SelectorValue::of(l != r);
+            case Op::Lt: return SelectorValue::of(l < r);
+            case Op::Le: return SelectorValue::of(l <= r);
+            case Op::Gt: return SelectorValue::of(l > r);
+            default: return SelectorValue::of(l >= r);
+        }
+    }
+
+    // Numbers win: a header compared with a numeric literal is parsed as a
+    // number. Two strings compare as numbers when both parse, otherwise
+    // only = and <> are defined.
+    static SelectorValue compare(Op op, const SelectorValue& l, const SelectorValue& r) {
+        using Type = SelectorValue::Type;
+        if (l.type == Type::Null || r.type == Type::Null) {
+            return SelectorValue::null();
+        }
+        double x = 0;
+        double y = 0;
+        if (l.type == Type::Number || r.type == Type::Number) {
+            if (!toNumber(l, x) || !toNumber(r, y)) {
+                return SelectorValue::null();
+            }
+            return ordered(op, x, y);
+        }
+        if (l.type == Type::Bool || r.type == Type::Bool) {
+            SelectorValue lb = toBool(l);
+            SelectorValue rb = toBool(r);
+            if (lb.type == Type::Null || rb.type == Type::Null || (op != Op::Eq && op != Op::Ne)) {
+                return SelectorValue::null();
+            }
+            return SelectorValue::of((lb.boolean == rb.boolean) == (op == Op::Eq));
+        }
+        if (op == Op::Eq || op == Op::Ne) {
+            return SelectorValue::of((l.text == r.text) == (op == Op::Eq));
+        }
+        if (toNumber(l, x) && toNumber(r, y)) {
+            return ordered(op, x, y);
+        }
+        return SelectorValue::null();
+    }
+
+    static SelectorValue arithmetic(Op op, const SelectorValue& l, const SelectorValue& r) {
+        double x = 0;
+        double y = 0;
+        if (!toNumber(l, x) || !toNumber(r, y)) {
+            return SelectorValue::null();
+        }
+        switch (op) {
+            case Op::Add: return SelectorValue::of(x + y);
+            case Op::Sub: return SelectorValue::of(x - y);
+            case Op::Mul: return SelectorValue::of(x * y);
+            default: return y == 0 ? SelectorValue::null() : SelectorValue::of(x / y);
+        }
+    }
+
+    // Greedy wildcard match with single-star backtracking.
+    static bool likeMatch(std::string_view value, std::string_view pattern) {
+        size_t v = 0;
+        size_t p = 0;
+        size_t star = std::string_view::npos;
+        size_t mark = 0;
+        while (v < value.size()) {
+            if (p < pattern.size() && (pattern[p] == kAnyChar || pattern[p] == value[v])) {
+                ++v;
+                ++p;
+            } else if (p < pattern.size() && pattern[p] == kAnySequence) {
+                star = p++;
+                mark = v;
+            } else if (star != std::string_view::npos) {
+                p = star + 1;
+                v = ++mark;
+            } else {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == kAnySequence) {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+
+    enum class Token : uint8_t {
+        End, Error, Identifier, String, Number,
+        LParen, RParen, Comma,
+        Eq, Ne, Lt, Le, Gt, Ge, Plus, Minus, Star, Slash,
+        And, Or, Not, Between, In, Like, Escape, Is, Null, True, False,
+    };
+
+    class Parser {
+    public:
+        Parser(Selector& selector, std::string_view input) : selector(selector), input(input) { advance(); }
+
+        bool parse(std::string& error) {
+            if (token != Token::End) {
+                parseOr();
+            } else {
+                fail("empty selector");
+            }
+            if (!failed && token != Token::End) {
+                fail("unexpected input");
+            }
+            if (failed) {
+                error = message + " at offset " + std::to_string(error_offset);
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        // Guards each recursive descent so deeply nested input fails here
+        // instead of overflowing the C++ stack before the depth check in compile().
+        class Nesting {
+        public:
+            explicit Nesting(Parser& parser) : parser(parser) {
+                if (++parser.nesting > kMaxStack) {
+                    parser.fail("expression nests too deeply");
+                }
+            }
+            ~Nesting() { --parser.nesting; }
+
+        private:
+            Parser& parser;
+        };
+
+        void fail(const char* what) {
+            if (!failed) {
+                failed = true;
+                message = what;
+                error_offset = token_start;
+            }
+            token = Token::End;
+        }
+
+        void expect(Token expected, const char* what) {
+            if (token != expected) {
+                fail(what);
+                return;
+            }
+            advance();
+        }
+
+        void parseOr() {
+            parseAnd();
+            while (token == Token::Or) {
+                advance();
+                size_t jump = selector.emit({Op::JumpIfTrue});
+                parseAnd();
+                selector.emit({Op::Or});
+                selector.code[jump].a = static_cast<uint32_t>(selector.code.size());
+            }
+        }
+
+        void parseAnd() {
+            parseNot();
+            while (token == Token::And) {
+                advance();
+                size_t jump = selector.emit({Op::JumpIfFalse});
+                parseNot();
+                selector.emit({Op::And});
+                selector.code[jump].a = static_cast<uint32_t>(selector.code.size());
+            }
+        }
+
+        void parseNot() {
+            if (token == Token::Not) {
+                advance();
+                Nesting nested(*this);
+                if (failed) {
+                    return;
+                }
+                parseNot();
+                selector.emit({Op::Not});
+                return;
+            }
+            parseComparison();
+        }
+
+        void parseComparison() {
+            parseAdditive();
+            Op op;
+            switch (token) {
+                case Token::Eq: op = Op::Eq; break;
+                case Token::Ne: op = Op::Ne; break;
+                case Token::Lt: op = Op::Lt; break;
+                case Token::Le: op = Op::Le; break;
+                case Token::Gt: op = Op::Gt; break;
+                case Token::Ge: op = Op::Ge; break;
+                default: parsePredicate(); return;
+            }
+            advance();
+            parseAdditive();
+            selector.emit({op});
+        }
+
+        // [NOT] BETWEEN / IN / LIKE, IS [NOT] NULL
+        void parsePredicate() {
+            if (token == Token::Is) {
+                advance();
+                bool negate = token == Token::Not;
+                if (negate) {
+                    advance();
+                }
+                expect(Token::Null, "expected NULL");
+                selector.emit({Op::IsNull, negate});
+                return;
+            }
+            bool negate = false;
+            if (token == Token::Not) {
+                negate = true;
+                advance();
+                if (token != Token::Between && token != Token::In && token != Token::Like) {
+                    fail("expected BETWEEN, IN or LIKE after NOT");
+                    return;
+                }
+            }
+            if (token == Token::Between) {
+                advance();
+                parseAdditive();
+                expect(Token::And, "expected AND in BETWEEN");
+                parseAdditive();
+                selector.emit({Op::Between, negate});
+            } else if (token == Token::In) {
+                advance();
+                expect(Token::LParen, "expected ( after IN");
+                uint32_t first = static_cast<uint32_t>(selector.in_lists.size());
+                for (;;) {
+                    if (token != Token::String) {
+                        fail("expected string literal in IN list");
+                        return;
+                    }
+                    selector.in_lists.push_back(selector.intern(literal));
+                    advance();
+                    if (token != Token::Comma) {
+                        break;
+                    }
+                    advance();
+                }
+                expect(Token::RParen, "expected ) after IN list");
+                Instruction in{Op::In, negate};
+                in.a = first;
+                in.b = static_cast<uint32_t>(selector.in_lists.size()) - first;
+                selector.emit(in);
+            } else if (token == Token::Like) {
+                advance();
+                if (token != Token::String) {
+                    fail("expected pattern string after LIKE");
+                    return;
+                }
+                std::string pattern = literal;
+                advance();
+                char escape = 0;
+                if (token == Token::Escape) {
+                    advance();
+                    if (token != Token::String || literal.size() != 1) {
+                        fail("ESCAPE needs a single character string");
+                        return;
+                    }
+                    escape = literal[0];
+                    advance();
+                }
+                std::string compiled_pattern;
+                for (size_t i = 0; i < pattern.size(); ++i) {
+                    if (escape != 0 && pattern[i] == escape && i + 1 < pattern.size()) {
+                        compiled_pattern.push_back(pattern[++i]);
+                    } else if (pattern[i] == '%') {
+                        compiled_pattern.push_back(kAnySequence);
+                    } else if (pattern[i] == '_') {
+                        compiled_pattern.push_back(kAnyChar);
+                    } else {
+                        compiled_pattern.push_back(pattern[i]);
+                    }
+                }
+                auto [offset, length] = selector.intern(compiled_pattern);
+                Instruction like{Op::Like, negate};
+                like.a = offset;
+                like.b = length;
+                selector.emit(like);
+            }
+        }
+
+        void parseAdditive() {
+            parseMultiplicative();
+            while (token == Token::Plus || token == Token::Minus) {
+                Op op = token == Token::Plus ? Op::Add : Op::Sub;
+                advance();
+                parseMultiplicative();
+                selector.emit({op});
+            }
+        }
+
+        void parseMultiplicative() {
+            parseUnary();
+            while (token == Token::Star || token == Token::Slash) {
+                Op op = token == Token::Star ? Op::Mul : Op::Div;
+                advance();
+                parseUnary();
+                selector.emit({op});
+            }
+        }
+
+        void parseUnary() {
+            if (token == Token::Minus) {
+                advance();
+                Nesting nested(*this);
+                if (failed) {
+                    return;
+                }
+                parseUnary();
+                selector.emit({Op::Neg});
+                return;
+            }
+            if (token == Token::Plus) {
+                advance();
+                Nesting nested(*this);
+                if (failed) {
+                    return;
+                }
+                parseUnary();
+                return;
+            }
+            parsePrimary();
+        }
+
+        void parsePrimary() {
+            switch (token) {
+                case Token::LParen: {
+                    advance();
+                    Nesting nested(*this);
+                    if (failed) {
+                        return;
+                    }
+                    parseOr();
+                    expect(Token::RParen, "expected )");
+                    return;
+                }
+                case Token::Number: {
+                    Instruction push{Op::PushNumber};
+                    push.number = number;
+                    selector.emit(push);
+                    advance();
+                    return;
+                }
+                case Token::String: {
+                    auto [offset, length] = selector.intern(literal);
+                    Instruction push{Op::PushString};
+                    push.a = offset;
+                    push.b = length;
+                    selector.emit(push);
+                    advance();
+                    return;
+                }
+                case Token::True:
+                case Token::False: {
+                    Instruction push{Op::PushBool};
+                    push.a = token == Token::True;
+                    selector.emit(push);
+                    advance();
+                    return;
+                }
+                case Token::Null:
+                    selector.emit({Op::PushNull});
+                    advance();
+                    return;
+                case Token::Identifier: {
+                    auto [offset, length] = selector.intern(headerName(literal));
+                    Instruction load{Op::Load};
+                    load.a = offset;
+                    load.b = length;
+                    selector.emit(load);
+                    advance();
+                    return;
+                }
+                default:
+                    fail("expected a value");
+                    return;
+            }
+        }
+
+        // JMS header identifiers refer to the matching STOMP headers
+        static std::string_view headerName(std::string_view identifier) {
+            static const std::pair<std::string_view, std::string_view> kJmsHeaders[] = {
+                {"JMSMessageID", "message-id"},         {"JMSPriority", "priority"},
+                {"JMSTimestamp", "timestamp"},          {"JMSCorrelationID", "correlation-id"},
+                {"JMSExpiration", "expires"},           {"JMSType", "type"},
+                {"JMSDestination", "destination"},      {"JMSRedelivered", "redelivered"},
+            };
+            for (const auto& [jms, stomp] : kJmsHeaders) {
+                if (identifier == jms) {
+                    return stomp;
+                }
+            }
+            return identifier;
+        }
+
+        void advance() {
+            while (position < input.size() && std::isspace(static_cast<unsigned char>(input[position]))) {
+                ++position;
+            }
+            token_start = position;
+            if (position >= input.size()) {
+                token = Token::End;
+                return;
+            }
+            char c = input[position];
+            auto next_is = [&](char expected) {
+                if (position + 1 < input.size() && input[position + 1] == expected) {
+                    ++position;
+                    return true;
+                }
+                return false;
+            };
+            switch (c) {
+                case '(': token = Token::LParen; ++position; return;
+                case ')': token = Token::RParen; ++position; return;
+                case ',': token = Token::Comma; ++position; return;
+                case '=': token = Token::Eq; ++position; return;
+                case '+': token = Token::Plus; ++position; return;
+                case '-': token = Token::Minus; ++position; return;
+                case '*': token = Token::Star; ++position; return;
+                case '/': token = Token::Slash; ++position; return;
+                case '<':
+                    token = next_is('>') ? Token::Ne : next_is('=') ? Token::Le : Token::Lt;
+                    ++position;
+                    return;
+                case '>':
+                    token = next_is('=') ? Token::Ge : Token::Gt;
+                    ++position;
+                    return;
+                case '\'':
+                    lexString();
+                    return;
+                default:
+                    break;
+            }
+            if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+                lexNumber();
+                return;
+            }
+            if (std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '$') {
+                lexWord();
+                return;
+            }
+            fail("unexpected character");
+        }
+
+        // 'it''s' -> it's
+        void lexString() {
+            literal.clear();
+            ++position;
+            while (position < input.size()) {
+                if (input[position] == '\'') {
+                    if (position + 1 < input.size() && input[position + 1] == '\'') {
+                        literal.push_back('\'');
+                        position += 2;
+                        continue;
+                    }
+                    ++position;
+                    token = Token::String;
+                    return;
+                }
+                literal.push_back(input[position++]);
+            }
+            fail("unterminated string");
+        }
+
+        void lexNumber() {
+            const char* begin = input.data() + position;
+            const char* end = input.data() + input.size();
+            auto result = std::from_chars(begin, end, number);
+            if (result.ec != std::errc()) {
+                fail("invalid number");
+                return;
+            }
+            position += static_cast<size_t>(result.ptr - begin);
+            // Java-style long/float suffixes
+            if (position < input.size() && std::strchr("lLfFdD", input[position]) != nullptr) {
+                ++position;
+            }
+            token = Token::Number;
+        }
+
+        void lexWord() {
+            size_t start = position;
+            while (position < input.size() &&
+                   (std::isalnum(static_cast<unsigned char>(input[position])) || input[position] == '_' ||
+                    input[position] == '$' || input[position] == '-')) {
+                ++position;
+            }
+            std::string_view word = input.substr(start, position - start);
+            static const std::pair<std::string_view, Token> kKeywords[] = {
+                {"AND", Token::And},   {"OR", Token::Or},         {"NOT", Token::Not},
+                {"BETWEEN", Token::Between}, {"IN", Token::In},   {"LIKE", Token::Like},
+                {"ESCAPE", Token::Escape},   {"IS", Token::Is},   {"NULL", Token::Null},
+                {"TRUE", Token::True},       {"FALSE", Token::False},
+            };
+            for (const auto& [keyword, keyword_token] : kKeywords) {
+                if (equalsIgnoreCase(word, keyword)) {
+                    token = keyword_token;
+                    return;
+                }
+            }
+            literal.assign(word);
+            token = Token::Identifier;
+        }
+
+        Selector& selector;
+        std::string_view input;
+        size_t position = 0;
+        size_t token_start = 0;
+        Token token = Token::End;
+        std::string literal;
+        double number = 0;
+        bool failed = false;
+        std::string message;
+        size_t error_offset = 0;
+        size_t nesting = 0;
+    };
+
+    std::string source;
+    std::vector<Instruction> code;
+    std::string pool;
+    std::vector<std::pair<uint32_t, uint32_t>> in_lists;
+    int depth = 0;
+    size_t max_depth = 0;
+    bool compiled = false;
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "latency.hpp"
+#include "mpsc_queue.hpp"
+#include "stomp_frame.hpp"
+#include "trace_context.hpp"
+
+// One finished span. Only sampled messages produce these, so the strings
+// are allowed to allocate.
+struct SpanRecord {
+    static constexpr int kProducer = 4;  // OTLP SpanKind
+    static constexpr int kConsumer = 5;
+
+    TraceContext context;        // trace id and this span's id
+    uint8_t parent_span_id[8] = {};
+    int kind = kConsumer;
+    std::string name;
+    uint64_t start_ns = 0;       // unix epoch ns
+    uint64_t end_ns = 0;
+    std::string destination;
+    std::string message_id;
+    uint64_t body_bytes = 0;
+    bool error = false;          // the handler rejected the message
+};
+
+// Writes spans to a file in the OTLP/JSON encoding, one
+// ExportTraceServiceRequest per line (what the OpenTelemetry Collector's
+// otlpjsonfile receiver reads). submit() is a lock-free push that never
+// waits: if the exporter thread falls behind, spans are dropped and counted.
+// The thread drains the queue every 100 ms in batches.
+class SpanExporter {
+public:
+    static constexpr size_t kMaxBatch = 512;
+
+    SpanExporter(std::string service_name, size_t queue_capacity = 4096)
+        : service(std::move(service_name)), queue(queue_capacity) {}
+
+    ~SpanExporter() { stop(); }
+
+    SpanExporter(const SpanExporter&) = delete;
+    SpanExporter& operator=(const SpanExporter&) = delete;
+
+    bool start(const std::string& path, std::string& error) {
+        file = std::fopen(path.c_str(), "a");
+        if (file == nullptr) {
+            error = "cannot open span file " + path;
+            return false;
+        }
+        running.store(true, std::memory_order_release);
+        exporter = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Exports whatever is still queued, then joins.
+    void stop() {
+        if (!exporter.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            running.store(false, std::memory_order_release);
+        }
+        wake_cv.notify_one();
+        exporter.join();
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    bool active() const { return running.load(std::memory_order_relaxed); }
+
+    bool submit(SpanRecord& span) {
+        if (!queue.tryPush(span)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t exportedCount() const { return exported.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    static void appendJsonString(std::string& out, std::string_view text) {
+        out.push_back('"');
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out.push_back('\\');
+                out.push_back(c);
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out.append(escaped);
+            } else {
+                out.push_back(c);
+            }
+        }
+        out.push_back('"');
+    }
+
+    static void appendHexString(std::string& out, const uint8_t* bytes, size_t count) {
+        char hex[32];
+        appendHex(hex, bytes, count);
+        out.push_back('"');
+        out.append(hex, 2 * count);
+        out.push_back('"');
+    }
+
+    static void appendAttribute(std::string& out, std::string_view key, std::string_view value) {
+        out.append("{\"key\":");
+        appendJsonString(out, key);
+        out.append(",\"value\":{\"stringValue\":");
+        appendJsonString(out, value);
+        out.append("}}");
+    }
+
+    void appendSpan(std::string& out, const SpanRecord& span) {
+        out.append("{\"traceId\":");
+        appendHexString(out, span.context.trace_id, sizeof(span.context.trace_id));
+        out.append(",\"spanId\":");
+        appendHexString(out, span.context.span_id, sizeof(span.context.span_id));
+        if (!allZero(span.parent_span_id, sizeof(span.parent_span_id))) {
+            out.append(",\"parentSpanId\":");
+            appendHexString(out, span.parent_span_id, sizeof(span.parent_span_id));
+        }
+        out.append(",\"name\":");
+        appendJsonString(out, span.name);
+        // OTLP JSON encodes 64-bit integers as strings
+        out.append(",\"kind\":").append(std::to_string(span.kind));
+        out.append(",\"startTimeUnixNano\":\"").append(std::to_string(span.start_ns));
+        out.append("\",\"endTimeUnixNano\":\"").append(std::to_string(span.end_ns)).append("\",\"attributes\":[");
+        appendAttribute(out, "messaging.system", "activemq");
+        out.push_back(',');
+        appendAttribute(out, "messaging.operation.type", span.kind == SpanRecord::kProducer ? "send" : "process");
+        out.push_back(',');
+        appendAttribute(out, "messaging.destination.name", span.destination);
+        out.push_back(',');
+        appendAttribute(out, "messaging.message.id", span.message_id);
+        out.append(",{\"key\":\"messaging.message.body.size\",\"value\":{\"intValue\":\"")
+            .append(std::to_string(span.body_bytes))
+            .append("\"}}]");
+        // STATUS_CODE_ERROR = 2
+        if (span.error) {
+            out.append(",\"status\":{\"code\":2}");
+        }
+        out.push_back('}');
+    }
+
+    void writeBatch(const std::vector<SpanRecord>& batch, std::string& line) {
+        line.clear();
+        line.append("{\"resourceSpans\":[{\"resource\":{\"attributes\":[");
+        appendAttribute(line, "service.name", service);
+        line.append("]},\"scopeSpans\":[{\"scope\":{\"name\":\"cpp-stomp\"},\"spans\":[");
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (i > 0) {
+                line.push_back(',');
+            }
+            appendSpan(line, batch[i]);
+        }
+        line.append("]}]}]}\n");
+        std::fwrite(line.data(), 1, line.size(), file);
+        std::fflush(file);
+        exported.fetch_add(batch.size(), std::memory_order_relaxed);
+    }
+
+    void run() {
+        std::vector<SpanRecord> batch;
+        batch.reserve(kMaxBatch);
+        std::string line;
+        SpanRecord span;
+        for (;;) {
+            bool stopping = !running.load(std::memory_order_acquire);
+            while (batch.size() < kMaxBatch && queue.tryPop(span)) {
+                batch.push_back(std::move(span));
+            }
+            if (!batch.empty()) {
+                writeBatch(batch, line);
+                batch.clear();
+                continue;
+            }
+            if (stopping) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake_cv.wait_for(lock, std::chrono::milliseconds(100),
+                             [this] { return !running.load(std::memory_order_acquire); });
+        }
+    }
+
+    std::string service;
+    MpscQueue<SpanRecord> queue;
+    std::FILE* file = nullptr;
+    std::thread exporter;
+    std::atomic<bool> running{false};
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    std::atomic<uint64_t> exported{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+// CONSUMER span around a message handler, parented to the message's sampled
+// traceparent. Does nothing (no allocation) for unsampled messages or when
+// the exporter is off. A handler that throws marks the span as an error.
+class ConsumerSpan {
+public:
+    ConsumerSpan(SpanExporter& exporter, const StompFrameView& frame, uint64_t start_ns)
+        : exporter(exporter), exceptions(std::uncaught_exceptions()) {
+        TraceContext parent;
+        if (!exporter.active() || !parseTraceparent(frame.header("traceparent"), parent) || !parent.sampled()) {
+            return;
+        }
+        active = true;
+        span.context = TraceIdGenerator::child(&parent, true);
+        std::memcpy(span.parent_span_id, parent.span_id, sizeof(span.parent_span_id));
+        span.destination = frame.header("destination");
+        span.message_id = frame.header("message-id");
+        span.name = "process " + span.destination;
+        span.body_bytes = frame.body.size();
+        span.start_ns = start_ns;
+    }
+
+    ~ConsumerSpan() {
+        if (active) {
+            span.error = std::uncaught_exceptions() > exceptions;
+            span.end_ns = realtimeNs();
+            exporter.submit(span);
+        }
+    }
+
+    ConsumerSpan(const ConsumerSpan&) = delete;
+    ConsumerSpan& operator=(const ConsumerSpan&) = delete;
+
+private:
+    SpanExporter& exporter;
+    SpanRecord span;
+    int exceptions;
+    bool active = false;
+};
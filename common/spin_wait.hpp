@@ -0,0 +1,50 @@
+#pragma once
+
+#include <sched.h>
+#include <string_view>
+
+// Hint to the core that we are in a spin loop (frees pipeline resources for
+// the sibling hyperthread and avoids memory-order mis-speculation on exit).
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// What a spinning thread does between polls.
+enum class SpinStrategy {
+    Pause,  // cpuRelax(): lowest latency, keeps the core fully busy
+    Yield,  // sched_yield(): lets other runnable threads on the core in
+    None,   // tight loop
+};
+
+inline const char* spinStrategyName(SpinStrategy strategy) {
+    switch (strategy) {
+        case SpinStrategy::Yield: return "yield";
+        case SpinStrategy::None: return "none";
+        default: return "pause";
+    }
+}
+
+inline bool parseSpinStrategy(std::string_view text, SpinStrategy& strategy) {
+    if (text == "pause") {
+        strategy = SpinStrategy::Pause;
+    } else if (text == "yield") {
+        strategy = SpinStrategy::Yield;
+    } else if (text == "none") {
+        strategy = SpinStrategy::None;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline void spinPause(SpinStrategy strategy) {
+    switch (strategy) {
+        case SpinStrategy::Pause: cpuRelax(); break;
+        case SpinStrategy::Yield: sched_yield(); break;
+        case SpinStrategy::None: break;
+    }
+}
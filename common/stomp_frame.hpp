@@ -0,0 +1,280 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "buffer_pool.hpp"
+
+// Builds a STOMP frame directly into a pooled buffer:
+//   StompFrameBuilder("SEND").header("destination", dest).finish(body)
+class StompFrameBuilder {
+public:
+    explicit StompFrameBuilder(std::string_view command, size_t size_hint = 256) : frame(size_hint) {
+        frame.append(command);
+        frame.push_back('\n');
+    }
+
+    StompFrameBuilder& header(std::string_view name, std::string_view value) {
+        frame.append(name);
+        frame.push_back(':');
+        frame.append(value);
+        frame.push_back('\n');
+        return *this;
+    }
+
+    // STOMP 1.2 escaping (\\ \n \r \c) for values that may contain ':' or
+    // line breaks, e.g. selectors. Not valid in CONNECT frames.
+    StompFrameBuilder& escapedHeader(std::string_view name, std::string_view value) {
+        frame.append(name);
+        frame.push_back(':');
+        for (char c : value) {
+            switch (c) {
+                case '\\': frame.append("\\\\"); break;
+                case '\n': frame.append("\\n"); break;
+                case '\r': frame.append("\\r"); break;
+                case ':': frame.append("\\c"); break;
+                default: frame.push_back(c); break;
+            }
+        }
+        frame.push_back('\n');
+        return *this;
+    }
+
+    StompFrameBuilder& header(std::string_view name, uint64_t value) {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        return header(name, std::string_view(digits, result.ptr - digits));
+    }
+
+    // Appends a pre-rendered block of "name:value\n" lines.
+    StompFrameBuilder& headers(std::string_view block) {
+        frame.append(block);
+        return *this;
+    }
+
+    PooledBuffer finish(std::string_view body = {}) {
+        frame.push_back('\n');
+        frame.append(body);
+        frame.push_back('\0');
+        return std::move(frame);
+    }
+
+private:
+    PooledBuffer frame;
+};
+
+struct StompHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+// Zero-copy view of a parsed frame. All views point into the buffer that was
+// parsed, so the view is only valid while that buffer is.
+class StompFrameView {
+public:
+    static constexpr size_t kMaxHeaders = 32;
+
+    std::string_view command;
+    std::string_view body;
+
+    size_t headerCount() const { return header_count; }
+    const StompHeader& headerAt(size_t index) const { return headers[index]; }
+
+    // STOMP says the first occurrence of a repeated header wins.
+    std::string_view header(std::string_view name) const {
+        for (size_t i = 0; i < header_count; ++i) {
+            if (headers[i].name == name) {
+                return headers[i].value;
+            }
+        }
+        return {};
+    }
+
+    // nullptr when absent; lets callers tell a missing header from an empty one
+    const StompHeader* findHeader(std::string_view name) const {
+        for (size_t i = 0; i < header_count; ++i) {
+            if (headers[i].name == name) {
+                return &headers[i];
+            }
+        }
+        return nullptr;
+    }
+
+    bool hasHeader(std::string_view name) const {
+        for (size_t i = 0; i < header_count; ++i) {
+            if (headers[i].name == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear() {
+        command = {};
+        body = {};
+        header_count = 0;
+    }
+
+    bool addHeader(std::string_view name, std::string_view value) {
+        if (header_count == kMaxHeaders) {
+            return false;
+        }
+        headers[header_count++] = StompHeader{name, value};
+        return true;
+    }
+
+private:
+    StompHeader headers[kMaxHeaders];
+    size_t header_count = 0;
+};
+
+enum class ParseStatus {
+    Complete,
+    Incomplete,
+    Malformed,
+};
+
+struct ParseResult {
+    ParseStatus status;
+    size_t consumed;  // bytes used, including leading heart-beat EOLs
+};
+
+inline std::string_view trimCarriageReturn(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+// Parses one frame from the front of `data`. Leading EOLs (heart-beats) are
+// skipped and counted in `consumed` even when the frame itself is incomplete.
+inline ParseResult parseStompFrame(const char* data, size_t length, StompFrameView& out) {
+    out.clear();
+    size_t pos = 0;
+    while (pos < length && (data[pos] == '\n' || data[pos] == '\r')) {
+        ++pos;
+    }
+    size_t frame_start = pos;
+    if (pos == length) {
+        return {ParseStatus::Incomplete, pos};
+    }
+
+    auto next_line = [&](std::string_view& line) {
+        const void* eol = std::memchr(data + pos, '\n', length - pos);
+        if (eol == nullptr) {
+            return false;
+        }
+        size_t end = static_cast<const char*>(eol) - data;
+        line = trimCarriageReturn(std::string_view(data + pos, end - pos));
+        pos = end + 1;
+        return true;
+    };
+
+    std::string_view line;
+    if (!next_line(line)) {
+        return {ParseStatus::Incomplete, frame_start};
+    }
+    out.command = line;
+
+    size_t content_length = SIZE_MAX;
+    for (;;) {
+        if (!next_line(line)) {
+            return {ParseStatus::Incomplete, frame_start};
+        }
+        if (line.empty()) {
+            break;
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            return {ParseStatus::Malformed, frame_start};
+        }
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = line.substr(colon + 1);
+        if (!out.hasHeader(name)) {
+            if (!out.addHeader(name, value)) {
+                return {ParseStatus::Malformed, frame_start};
+            }
+            if (name == "content-length") {
+                size_t parsed = 0;
+                auto result = std::from_chars(value.data(), value.data() + value.size(), parsed);
+                if (result.ec != std::errc() || result.ptr != value.data() + value.size()) {
+                    return {ParseStatus::Malformed, frame_start};
+                }
+                content_length = parsed;
+            }
+        }
+    }
+
+    size_t body_start = pos;
+    size_t body_end = 0;
+    if (content_length != SIZE_MAX) {
+        if (length - body_start < content_length + 1) {
+            return {ParseStatus::Incomplete, frame_start};
+        }
+        body_end = body_start + content_length;
+        if (data[body_end] != '\0') {
+            return {ParseStatus::Malformed, frame_start};
+        }
+    } else {
+        const void* nul = std::memchr(data + body_start, '\0', length - body_start);
+        if (nul == nullptr) {
+            return {ParseStatus::Incomplete, frame_start};
+        }
+        body_end = static_cast<const char*>(nul) - data;
+    }
+    out.body = std::string_view(data + body_start, body_end - body_start);
+    return {ParseStatus::Complete, body_end + 1};
+}
+
+// A received frame that owns a pooled copy of its bytes, so it can outlive
+// the receive buffer it was parsed from.
+class StompMessage {
+public:
+    StompMessage() = default;
+
+    StompMessage(StompMessage&& other) noexcept { *this = std::move(other); }
+
+    StompMessage& operator=(StompMessage&& other) noexcept {
+        if (this != &other) {
+            bytes = std::move(other.bytes);
+            frame = other.frame;
+            other.frame.clear();
+        }
+        return *this;
+    }
+
+    StompMessage(const StompMessage&) = delete;
+    StompMessage& operator=(const StompMessage&) = delete;
+
+    // Copies a parsed frame out of a transient buffer and re-points the view.
+    bool assign(const char* raw, size_t length) {
+        bytes.clear();
+        bytes.append(raw, length);
+        return parseStompFrame(bytes.data(), bytes.size(), frame).status == ParseStatus::Complete;
+    }
+
+    // Copies a frame parsed by parseStompFrame(): its bytes run from the
+    // command to the terminating NUL after the body.
+    bool assign(const StompFrameView& view) {
+        return assign(view.command.data(),
+                      static_cast<size_t>(view.body.data() + view.body.size() + 1 - view.command.data()));
+    }
+
+    bool empty() const { return frame.command.empty(); }
+    void clear() {
+        bytes.clear();
+        frame.clear();
+    }
+
+    std::string_view command() const { return frame.command; }
+    std::string_view header(std::string_view name) const { return frame.header(name); }
+    std::string_view body() const { return frame.body; }
+    const StompFrameView& view() const { return frame; }
+
+private:
+    PooledBuffer bytes;
+    StompFrameView frame;
+};
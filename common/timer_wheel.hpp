@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hashed timing wheel: O(1) schedule and O(expired + slot occupancy) per
+// tick. Delays are rounded up to whole ticks; timers further out than one
+// revolution wait in their slot for the remaining number of rounds.
+// Single-threaded: schedule() and advance() must run on the same thread.
+template <typename T>
+class TimerWheel {
+public:
+    TimerWheel(uint64_t tick_ns, size_t slot_count, uint64_t now_ns)
+        : tick_ns(tick_ns), current_tick(now_ns / tick_ns) {
+        size_t slots_rounded = 1;
+        while (slots_rounded < slot_count) {
+            slots_rounded <<= 1;
+        }
+        mask = slots_rounded - 1;
+        slots.resize(slots_rounded);
+    }
+
+    size_t size() const { return pending; }
+    bool empty() const { return pending == 0; }
+    uint64_t tickNs() const { return tick_ns; }
+
+    void schedule(uint64_t delay_ns, T payload) {
+        uint64_t ticks = (delay_ns + tick_ns - 1) / tick_ns;
+        if (ticks == 0) {
+            ticks = 1;
+        }
+        uint64_t due = current_tick + ticks;
+        slots[due & mask].push_back(Entry{(ticks - 1) / slots.size(), std::move(payload)});
+        ++pending;
+    }
+
+    // Fires every timer due at or before `now_ns`, calling fn(T&) for each.
+    // fn may schedule new timers; those never fire within the same call.
+    template <typename Fn>
+    size_t advance(uint64_t now_ns, Fn&& fn) {
+        uint64_t target = now_ns / tick_ns;
+        size_t fired = 0;
+        while (current_tick < target && pending > 0) {
+            ++current_tick;
+            std::vector<Entry>& slot = slots[current_tick & mask];
+            expired.clear();
+            for (size_t i = 0; i < slot.size();) {
+                if (slot[i].rounds == 0) {
+                    expired.push_back(std::move(slot[i].payload));
+                    if (i + 1 != slot.size()) {
+                        slot[i] = std::move(slot.back());
+                    }
+                    slot.pop_back();
+                } else {
+                    --slot[i].rounds;
+                    ++i;
+                }
+            }
+            pending -= expired.size();
+            for (T& payload : expired) {
+                fn(payload);
+                ++fired;
+            }
+        }
+        // Nothing pending: jump straight to now instead of walking empty ticks
+        if (current_tick < target) {
+            current_tick = target;
+        }
+        return fired;
+    }
+
+private:
+    struct Entry {
+        uint64_t rounds;
+        T payload;
+    };
+
+    uint64_t tick_ns;
+    uint64_t current_tick;
+    size_t mask = 0;
+    size_t pending = 0;
+    std::vector<std::vector<Entry>> slots;
+    std::vector<T> expired;
+};
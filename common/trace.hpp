@@ -0,0 +1,265 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "latency.hpp"
+
+// Hot-path trace points. TRACE_SCOPE("encode") times the enclosing block into
+// a per-thread ring; Tracer::instance().writeChromeTrace() exports every ring
+// as Chrome trace / Perfetto JSON (open in ui.perfetto.dev or chrome://tracing).
+//
+// Build with STOMP_TRACE=0 (cmake -DSTOMP_TRACING=OFF) and the macros expand
+// to nothing. Compiled in but not enabled, a trace point costs one relaxed
+// load and a predictable branch; enabled, two timestamp reads and a 32-byte
+// store. Timestamps are the TSC on x86 and are converted to wall-clock time
+// on export, so producer and consumer traces can be merged on one timeline.
+#ifndef STOMP_TRACE
+#define STOMP_TRACE 1
+#endif
+
+inline uint64_t traceTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return monotonicNs();
+#endif
+}
+
+struct TraceEvent {
+    uint64_t start;    // traceTicks(), or wall-clock ns when `wall` is set
+    uint64_t end;
+    const char* name;  // string literal
+    uint32_t arg;      // stage-specific: bytes, frames, sequence...
+    uint32_t wall;     // 1 for spans recorded in realtimeNs(), e.g. across processes
+};
+
+// Single-writer ring that keeps the most recent `capacity` events.
+class TraceRing {
+public:
+    TraceRing(size_t capacity, std::string thread_name)
+        : events(roundUpPow2(capacity)), mask(events.size() - 1), name(std::move(thread_name)) {}
+
+    void push(const TraceEvent& event) {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        events[index & mask] = event;
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        uint64_t end = head.load(std::memory_order_acquire);
+        uint64_t begin = end > events.size() ? end - events.size() : 0;
+        for (uint64_t i = begin; i < end; ++i) {
+            fn(events[i & mask]);
+        }
+    }
+
+    uint64_t dropped() const {
+        uint64_t written = head.load(std::memory_order_acquire);
+        return written > events.size() ? written - events.size() : 0;
+    }
+
+    const std::string& threadName() const { return name; }
+
+private:
+    static size_t roundUpPow2(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    std::vector<TraceEvent> events;
+    size_t mask;
+    std::string name;
+    std::atomic<uint64_t> head{0};
+};
+
+// Owns one ring per thread that ever recorded an event. Rings outlive their
+// threads so the export sees everything.
+class Tracer {
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    // Call before the threads being traced start recording.
+    void enable(size_t events_per_thread) {
+        ring_capacity = events_per_thread;
+        anchor_ticks = traceTicks();
+        anchor_ns = realtimeNs();
+        anchor_steady_ns = monotonicNs();
+        enabled_flag.store(true, std::memory_order_release);
+    }
+
+    bool enabled() const { return enabled_flag.load(std::memory_order_relaxed); }
+
+    void record(const char* name, uint64_t start_ticks, uint64_t end_ticks, uint32_t arg) {
+        threadRing().push(TraceEvent{start_ticks, end_ticks, name, arg, 0});
+    }
+
+    // A span measured in wall-clock ns, e.g. sent-at-ns to receive time.
+    void recordWall(const char* name, uint64_t start_ns, uint64_t end_ns, uint32_t arg) {
+        threadRing().push(TraceEvent{start_ns, end_ns, name, arg, 1});
+    }
+
+    // Writes every ring as "complete" (ph:X) events plus thread names.
+    bool writeChromeTrace(const std::string& path, std::string& error) {
+        std::ofstream out(path);
+        if (!out) {
+            error = "cannot write trace file " + path;
+            return false;
+        }
+        // Ticks per ns over the whole run, against the monotonic clock
+        uint64_t elapsed_ticks = traceTicks() - anchor_ticks;
+        uint64_t elapsed_ns = monotonicNs() - anchor_steady_ns;
+        double ns_per_tick = elapsed_ticks > 0 && elapsed_ns > 0
+                                 ? static_cast<double>(elapsed_ns) / static_cast<double>(elapsed_ticks)
+                                 : 1.0;
+        auto wall_us = [&](const TraceEvent& event, uint64_t value) {
+            if (event.wall != 0) {
+                return static_cast<double>(value) / 1000.0;
+            }
+            double offset_ns = (static_cast<double>(value) - static_cast<double>(anchor_ticks)) * ns_per_tick;
+            return (static_cast<double>(anchor_ns) + offset_ns) / 1000.0;
+        };
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const long pid = static_cast<long>(getpid());
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&] {
+            if (!first) {
+                out << ",\n";
+            }
+            first = false;
+        };
+        out.setf(std::ios::fixed);
+        out.precision(3);
+        for (size_t tid = 0; tid < rings.size(); ++tid) {
+            separator();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << tid + 1
+                << ",\"args\":{\"name\":\"" << rings[tid]->threadName() << "\"}}";
+            rings[tid]->forEach([&](const TraceEvent& event) {
+                double start = wall_us(event, event.start);
+                double end = wall_us(event, event.end);
+                separator();
+                out << "{\"ph\":\"X\",\"name\":\"" << event.name << "\",\"pid\":" << pid << ",\"tid\":" << tid + 1
+                    << ",\"ts\":" << start << ",\"dur\":" << (end > start ? end - start : 0.0)
+                    << ",\"args\":{\"arg\":" << event.arg << "}}";
+            });
+        }
+        out << "\n]}\n";
+        if (!out) {
+            error = "error writing trace file " + path;
+            return false;
+        }
+        return true;
+    }
+
+    size_t threadCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return rings.size();
+    }
+
+    uint64_t droppedEvents() {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t dropped = 0;
+        for (const auto& ring : rings) {
+            dropped += ring->dropped();
+        }
+        return dropped;
+    }
+
+private:
+    TraceRing& threadRing() {
+        thread_local TraceRing* ring = nullptr;
+        if (ring == nullptr) {
+            char name[16] = "thread";
+            pthread_getname_np(pthread_self(), name, sizeof(name));
+            std::lock_guard<std::mutex> lock(mutex);
+            rings.push_back(std::make_unique<TraceRing>(ring_capacity, name));
+            ring = rings.back().get();
+        }
+        return *ring;
+    }
+
+    std::atomic<bool> enabled_flag{false};
+    size_t ring_capacity = 65536;
+    uint64_t anchor_ticks = 0;
+    uint64_t anchor_ns = 0;
+    uint64_t anchor_steady_ns = 0;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TraceRing>> rings;
+};
+
+// Times its own lifetime. Use through TRACE_SCOPE.
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, uint32_t arg = 0)
+        : name(name), arg(arg), start(Tracer::instance().enabled() ? traceTicks() : 0) {}
+
+    ~TraceScope() {
+        if (start != 0) {
+            Tracer::instance().record(name, start, traceTicks(), arg);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    void setArg(uint32_t value) { arg = value; }
+
+    // Drops the event, e.g. for a poll that found nothing.
+    void cancel() { start = 0; }
+
+private:
+    const char* name;
+    uint32_t arg;
+    uint64_t start;
+};
+
+// Stand-in for a named TraceScope when tracing is compiled out.
+struct NullTraceScope {
+    void setArg(uint32_t) {}
+    void cancel() {}
+};
+
+#define STOMP_TRACE_CONCAT_INNER(a, b) a##b
+#define STOMP_TRACE_CONCAT(a, b) STOMP_TRACE_CONCAT_INNER(a, b)
+
+// TRACE_SCOPE_NAMED(var, name) declares `var` so the code can setArg() once
+// the value is known or cancel() an empty event.
+#if STOMP_TRACE
+#define TRACE_SCOPE_NAMED(var, name) TraceScope var(name)
+#define TRACE_SCOPE(name) TraceScope STOMP_TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg) \
+    TraceScope STOMP_TRACE_CONCAT(trace_scope_, __LINE__)(name, static_cast<uint32_t>(arg))
+#define TRACE_WALL_SPAN(name, start_ns, end_ns, arg)                                                \
+    do {                                                                                            \
+        if (Tracer::instance().enabled()) {                                                         \
+            Tracer::instance().recordWall(name, start_ns, end_ns, static_cast<uint32_t>(arg));       \
+        }                                                                                           \
+    } while (0)
+#else
+#define TRACE_SCOPE_NAMED(var, name) NullTraceScope var
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_ARG(name, arg) ((void)0)
+#define TRACE_WALL_SPAN(name, start_ns, end_ns, arg) ((void)0)
+#endif
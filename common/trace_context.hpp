@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string_view>
+#include <thread>
+
+// W3C Trace Context (https://www.w3.org/TR/trace-context/) carried in a
+// `traceparent` header: "00-<32 hex trace-id>-<16 hex parent-id>-<2 hex flags>".
+struct TraceContext {
+    static constexpr size_t kHeaderLength = 55;
+    static constexpr uint8_t kSampledFlag = 0x01;
+
+    uint8_t trace_id[16] = {};
+    uint8_t span_id[8] = {};
+    uint8_t flags = 0;
+
+    bool sampled() const { return (flags & kSampledFlag) != 0; }
+};
+
+inline void appendHex(char* out, const uint8_t* bytes, size_t count) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    for (size_t i = 0; i < count; ++i) {
+        out[2 * i] = kDigits[bytes[i] >> 4];
+        out[2 * i + 1] = kDigits[bytes[i] & 0x0f];
+    }
+}
+
+// Lowercase hex only, as the spec requires.
+inline bool decodeHex(std::string_view text, uint8_t* bytes) {
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        return -1;
+    };
+    for (size_t i = 0; i < text.size() / 2; ++i) {
+        int high = nibble(text[2 * i]);
+        int low = nibble(text[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        bytes[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+inline bool allZero(const uint8_t* bytes, size_t count) {
+    return std::all_of(bytes, bytes + count, [](uint8_t b) { return b == 0; });
+}
+
+// Writes exactly kHeaderLength characters (no terminator).
+inline std::string_view formatTraceparent(const TraceContext& context, char (&out)[TraceContext::kHeaderLength]) {
+    std::memcpy(out, "00-", 3);
+    appendHex(out + 3, context.trace_id, 16);
+    out[35] = '-';
+    appendHex(out + 36, context.span_id, 8);
+    out[52] = '-';
+    appendHex(out + 53, &context.flags, 1);
+    return std::string_view(out, sizeof(out));
+}
+
+// Accepts version 00 and, as the spec asks, the version-00 prefix of later
+// versions. All-zero ids and version ff are invalid.
+inline bool parseTraceparent(std::string_view text, TraceContext& out) {
+    constexpr size_t kLength = TraceContext::kHeaderLength;
+    uint8_t version = 0;
+    if (text.size() < kLength || text[2] != '-' || text[35] != '-' || text[52] != '-' ||
+        !decodeHex(text.substr(0, 2), &version) || version == 0xff ||
+        (version == 0 ? text.size() != kLength : text.size() > kLength && text[kLength] != '-')) {
+        return false;
+    }
+    return decodeHex(text.substr(3, 32), out.trace_id) && !allZero(out.trace_id, sizeof(out.trace_id)) &&
+           decodeHex(text.substr(36, 16), out.span_id) && !allZero(out.span_id, sizeof(out.span_id)) &&
+           decodeHex(text.substr(53, 2), &out.flags);
+}
+
+// Per-thread xorshift generator for ids and sampling decisions; seeded once
+// per thread from std::random_device, then a few cycles per call.
+class TraceIdGenerator {
+public:
+    static uint64_t next() {
+        thread_local uint64_t state = seed();
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    static void fill(uint8_t* bytes, size_t count) {
+        for (size_t i = 0; i < count; i += 8) {
+            uint64_t value = next();
+            std::memcpy(bytes + i, &value, std::min<size_t>(8, count - i));
+        }
+    }
+
+    // A child of `parent` (same trace, new span id), or a new root.
+    static TraceContext child(const TraceContext* parent, bool sampled) {
+        TraceContext context;
+        if (parent != nullptr) {
+            std::memcpy(context.trace_id, parent->trace_id, sizeof(context.trace_id));
+        } else {
+            fill(context.trace_id, sizeof(context.trace_id));
+        }
+        fill(context.span_id, sizeof(context.span_id));
+        context.flags = sampled ? TraceContext::kSampledFlag : 0;
+        return context;
+    }
+
+private:
+    static uint64_t seed() {
+        std::random_device device;
+        uint64_t value = (static_cast<uint64_t>(device()) << 32) ^ device() ^
+                         std::hash<std::thread::id>()(std::this_thread::get_id());
+        return value != 0 ? value : 0x9e3779b97f4a7c15ull;
+    }
+};
+
+// Head-based sampling: the producer decides once per message and only
+// sampled messages get a traceparent, so an unsampled send costs one
+// random draw and a compare.
+inline bool sampleTrace(double ratio) {
+    return ratio >= 1 || (ratio > 0 && static_cast<double>(TraceIdGenerator::next() >> 11) * 0x1.0p-53 < ratio);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "destination_trie.hpp"
+#include "stomp_frame.hpp"
+
+// Fans MESSAGE frames out to handlers registered by destination pattern
+// (Artemis '*' / '#' wildcards allowed), e.g. one wildcard subscription
+// on "orders.#" feeding separate handlers for "orders.eu.*" and
+// "orders.us.*". A frame is passed to every handler whose pattern matches
+// its destination header. Meant for fan-out inside one subscription, after
+// SubscriptionTable has routed the frame; register each pattern once.
+// Not thread-safe: call it from the thread that runs the handlers.
+class DestinationDispatcher {
+public:
+    using Handler = std::function<void(const StompFrameView&)>;
+
+    void on(std::string_view pattern, Handler handler) {
+        trie.insert(pattern, static_cast<uint32_t>(handlers.size()));
+        handlers.push_back(std::move(handler));
+    }
+
+    // Returns the number of handlers invoked.
+    size_t dispatch(const StompFrameView& frame) {
+        matched.clear();
+        size_t count = trie.match(frame.header("destination"), matched);
+        if (count == 0) {
+            ++unmatched_frames;
+            return 0;
+        }
+        for (uint32_t index : matched) {
+            handlers[index](frame);
+        }
+        return count;
+    }
+
+    uint64_t unmatched() const { return unmatched_frames; }
+
+private:
+    DestinationTrie trie;
+    std::vector<Handler> handlers;
+    std::vector<uint32_t> matched;
+    uint64_t unmatched_frames = 0;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "admin_server.hpp"
+#include "latency.hpp"
+#include "priority_queue.hpp"
+
+// Liveness, readiness and lag for orchestration, served on the admin port.
+// The receive loop and handlers only do relaxed atomic stores; the admin
+// thread derives everything else when probed:
+//   GET /healthz  200 unless a started loop has not come round for `stall_timeout`
+//   GET /readyz   200 while subscribed and consuming
+//   GET /lag      JSON with lag, idle time, local backlog and msgs/s
+class HealthMonitor {
+public:
+    explicit HealthMonitor(std::chrono::milliseconds stall_timeout)
+        : stall_timeout_ns(static_cast<uint64_t>(stall_timeout.count()) * 1'000'000ull),
+          rate_since_ns(monotonicNs()) {}
+
+    HealthMonitor(const HealthMonitor&) = delete;
+    HealthMonitor& operator=(const HealthMonitor&) = delete;
+
+    void setReady(bool value) { ready.store(value, std::memory_order_relaxed); }
+
+    // Once per receive loop iteration; loops that never beat are not checked.
+    void receiveBeat() { receive_beat_ns.store(monotonicNs(), std::memory_order_relaxed); }
+    void workerBeat() { worker_beat_ns.store(monotonicNs(), std::memory_order_relaxed); }
+
+    // For loops that beat from a timer: well inside the stall timeout, and
+    // short enough that the timer never holds up a shutdown for long.
+    std::chrono::milliseconds beatInterval() const {
+        auto quarter = std::chrono::milliseconds(stall_timeout_ns / 4'000'000);
+        return std::clamp(quarter, std::chrono::milliseconds(1), std::chrono::milliseconds(100));
+    }
+
+    // Handler thread, per message. `message_ns` is when the message was
+    // produced (sent-at-ns, else the broker's timestamp), 0 if unknown.
+    void recordMessage(uint64_t message_ns, uint64_t now_ns) {
+        messages.store(messages.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        handled_ns.store(now_ns, std::memory_order_relaxed);
+        if (message_ns != 0) {
+            last_message_ns.store(message_ns, std::memory_order_relaxed);
+        }
+    }
+
+    // Retries waiting in the redelivery wheel; handler thread.
+    void setPendingRetries(uint64_t count) { pending_retries.store(count, std::memory_order_relaxed); }
+
+    // The priority hand-off queue, if any; its size is read on demand.
+    void attachQueue(const PriorityMessageQueue* queue) { work_queue.store(queue, std::memory_order_release); }
+
+    void addRoutes(AdminServer& admin) {
+        admin.route("GET", "/healthz", [this](const AdminRequest&) {
+            std::string stalled = stalledLoop();
+            if (!stalled.empty()) {
+                return AdminResponse{503, "text/plain", stalled + " loop stalled\n"};
+            }
+            return AdminResponse{200, "text/plain", "ok\n"};
+        });
+        admin.route("GET", "/readyz", [this](const AdminRequest&) {
+            if (!ready.load(std::memory_order_relaxed) || !stalledLoop().empty()) {
+                return AdminResponse{503, "text/plain", "not ready\n"};
+            }
+            return AdminResponse{200, "text/plain", "ready\n"};
+        });
+        admin.route("GET", "/lag", [this](const AdminRequest&) {
+            return AdminResponse{200, "application/json", lagJson()};
+        });
+    }
+
+private:
+    std::string stalledLoop() const {
+        uint64_t now = monotonicNs();
+        auto silent = [&](const std::atomic<uint64_t>& beat) {
+            uint64_t last = beat.load(std::memory_order_relaxed);
+            return last != 0 && now > last && now - last > stall_timeout_ns;
+        };
+        if (silent(receive_beat_ns)) {
+            return "receive";
+        }
+        if (silent(worker_beat_ns)) {
+            return "worker";
+        }
+        return "";
+    }
+
+    // Admin thread only (the server handles one request at a time). The rate
+    // covers the window since it was last refreshed; windows are at least a
+    // second long, so probes closer together than that see the same value.
+    double messagesPerSecond(uint64_t count) {
+        uint64_t now = monotonicNs();
+        uint64_t elapsed = now - rate_since_ns;
+        double current =
+            elapsed > 0 ? static_cast<double>(count - rate_since_count) * 1e9 / static_cast<double>(elapsed) : 0.0;
+        if (elapsed >= 1'000'000'000ull) {
+            rate = current;
+            have_rate = true;
+            rate_since_ns = now;
+            rate_since_count = count;
+        }
+        return have_rate ? rate : current;
+    }
+
+    std::string lagJson() {
+        uint64_t now = realtimeNs();
+        uint64_t last_message = last_message_ns.load(std::memory_order_relaxed);
+        uint64_t handled = handled_ns.load(std::memory_order_relaxed);
+        uint64_t count = messages.load(std::memory_order_relaxed);
+        const PriorityMessageQueue* queue = work_queue.load(std::memory_order_acquire);
+        auto millis = [&](uint64_t since) {
+            return since != 0 && now > since ? std::to_string((now - since) / 1'000'000) : std::string("null");
+        };
+        char rate_text[32];
+        std::snprintf(rate_text, sizeof(rate_text), "%.1f", messagesPerSecond(count));
+
+        // lag_ms: now minus the newest processed message's timestamp.
+        // idle_ms: time since a message was last handled; when lag_ms is
+        // close to idle_ms the consumer is idle, not behind.
+        std::string json = "{\"ready\":";
+        json += ready.load(std::memory_order_relaxed) ? "true" : "false";
+        json += ",\"lag_ms\":" + millis(last_message);
+        json += ",\"idle_ms\":" + millis(handled);
+        json += ",\"queued\":" + std::to_string(queue != nullptr ? queue->sizeApprox() : 0);
+        json += ",\"pending_retries\":" + std::to_string(pending_retries.load(std::memory_order_relaxed));
+        json += ",\"messages\":" + std::to_string(count);
+        json += ",\"messages_per_second\":";
+        json += rate_text;
+        json += "}\n";
+        return json;
+    }
+
+    const uint64_t stall_timeout_ns;
+    std::atomic<bool> ready{false};
+    std::atomic<uint64_t> receive_beat_ns{0};  // monotonicNs()
+    std::atomic<uint64_t> worker_beat_ns{0};
+    std::atomic<uint64_t> messages{0};         // written by the handler thread only
+    std::atomic<uint64_t> handled_ns{0};       // realtimeNs()
+    std::atomic<uint64_t> last_message_ns{0};  // realtimeNs()
+    std::atomic<uint64_t> pending_retries{0};
+    std::atomic<const PriorityMessageQueue*> work_queue{nullptr};
+
+    // Admin thread only
+    uint64_t rate_since_ns;
+    uint64_t rate_since_count = 0;
+    double rate = 0;
+    bool have_rate = false;
+};
@@ -1,5 +1,9 @@
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <chrono>
 #include <thread>
 #include <sys/socket.h>
@@ -9,22 +13,250 @@
 #include <unistd.h>
 #include <cstring>
 #include <sstream>
+#include <iomanip>
+#include <cerrno>
+#include <charconv>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <poll.h>
 
-class SimpleStompClient {
+#include "admin_server.hpp"
+#include "arena.hpp"
+#include "async_stomp.hpp"
+#include "buffer_pool.hpp"
+#include "config.hpp"
+#include "cpu_affinity.hpp"
+#include "expiration.hpp"
+#include "frame_capture.hpp"
+#include "health_monitor.hpp"
+#include "latency.hpp"
+#include "live_config.hpp"
+#include "log_level.hpp"
+#include "message_decoder.hpp"
+#include "priority_queue.hpp"
+#include "redelivery.hpp"
+#include "ring_buffer.hpp"
+#include "sampling_profiler.hpp"
+#include "span_exporter.hpp"
+#include "spin_wait.hpp"
+#include "stomp_frame.hpp"
+#include "subscription_table.hpp"
+#include "trace.hpp"
+
+// How the I/O thread waits for data once the session is established.
+enum class ReceiveMode {
+    Blocking,  // blocking recv()
+    Epoll,     // non-blocking socket + epoll_wait()
+    BusyPoll,  // non-blocking recv() in a spin loop, optionally with SO_BUSY_POLL
+};
+
+inline const char* receiveModeName(ReceiveMode mode) {
+    switch (mode) {
+        case ReceiveMode::Epoll: return "epoll";
+        case ReceiveMode::BusyPoll: return "busy-poll";
+        default: return "blocking";
+    }
+}
+
+inline bool parseReceiveMode(std::string_view text, ReceiveMode& mode) {
+    if (text == "blocking") {
+        mode = ReceiveMode::Blocking;
+    } else if (text == "epoll") {
+        mode = ReceiveMode::Epoll;
+    } else if (text == "busy-poll" || text == "busypoll") {
+        mode = ReceiveMode::BusyPoll;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+struct ReceiveOptions {
+    size_t buffer_size = 4 * 1024 * 1024;  // rounded up to a power-of-two page multiple
+    HugePageMode huge_pages = HugePageMode::Off;
+    ReceiveMode mode = ReceiveMode::Blocking;
+    int busy_poll_usec = 50;               // SO_BUSY_POLL budget per recv, 0 to leave unset
+    SpinStrategy spin = SpinStrategy::Pause;
+    int poll_timeout_ms = 100;             // epoll wait / busy-poll spin budget per call
+};
+
+// Broker connection settings shared by the blocking and coroutine paths.
+struct BrokerSettings {
+    std::string host = "activemq";  // Docker service name
+    int port = 61613;               // STOMP port
+    int max_retries = 10;
+    std::chrono::milliseconds retry_interval{3000};
+};
+
+class SimpleStompClient : public AckSink {
 private:
     int sockfd;
     std::string host;
     int port;
     bool connected;
+    ReceiveOptions options;
+    ReceiveMode active_mode;
+    int epoll_fd;
+    MirroredRingBuffer recv_buffer;
+    uint64_t last_rx_timestamp_ns;
+    bool last_read_timed_out = false;
+    FrameCapture* capture = nullptr;
+    std::string stomp_version = "1.0";  // from CONNECTED; decides the ACK headers
+
+    // One recvmsg() into the ring, capturing the kernel receive timestamp.
+    ssize_t readSocket() {
+        iovec iov{recv_buffer.writePtr(), recv_buffer.writable()};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(timespec))];
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        TRACE_SCOPE_NAMED(trace, "recv");
+        ssize_t bytes_read = recvmsg(sockfd, &msg, 0);
+        if (bytes_read > 0) {
+            trace.setArg(static_cast<uint32_t>(bytes_read));
+        } else {
+            trace.cancel();  // busy-poll misses would flood the ring
+        }
+        last_read_timed_out = bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        if (bytes_read > 0) {
+            last_rx_timestamp_ns = 0;
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                    timespec ts;
+                    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                    last_rx_timestamp_ns = static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull + ts.tv_nsec;
+                }
+            }
+        }
+        return bytes_read;
+    }
+
+    // Reads once from the socket into the free space of the ring, waiting
+    // according to the active receive mode.
+    bool fillReceiveBuffer() {
+        if (recv_buffer.writable() == 0) {
+            std::cerr << "[CONSUMER] Frame larger than the " << recv_buffer.capacity()
+                      << " byte receive buffer, dropping buffered data" << std::endl;
+            recv_buffer.clear();
+        }
+
+        ssize_t bytes_read = -1;
+        switch (active_mode) {
+            case ReceiveMode::Blocking:
+                bytes_read = readSocket();
+                break;
+            case ReceiveMode::Epoll: {
+                epoll_event event;
+                if (epoll_wait(epoll_fd, &event, 1, options.poll_timeout_ms) <= 0) {
+                    return false;
+                }
+                bytes_read = readSocket();
+                break;
+            }
+            case ReceiveMode::BusyPoll: {
+                uint64_t deadline = monotonicNs() + static_cast<uint64_t>(options.poll_timeout_ms) * 1'000'000ull;
+                for (unsigned spins = 0;; ++spins) {
+                    bytes_read = readSocket();
+                    if (bytes_read >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                        break;
+                    }
+                    if ((spins & 63) == 63 && monotonicNs() > deadline) {
+                        return false;
+                    }
+                    spinPause(options.spin);
+                }
+                break;
+            }
+        }
+        if (bytes_read <= 0) {
+            return false;
+        }
+        recv_buffer.commit(static_cast<size_t>(bytes_read));
+        return true;
+    }
+
+    // Switches the established session from the blocking handshake to the
+    // configured receive mode.
+    void configureReceiveMode() {
+        active_mode = ReceiveMode::Blocking;
+        if (options.mode == ReceiveMode::Blocking) {
+            // Bounded waits let the receive loop run timers (e.g. redelivery) while idle
+            timeval timeout{options.poll_timeout_ms / 1000, (options.poll_timeout_ms % 1000) * 1000};
+            setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            return;
+        }
+        if (fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK) < 0) {
+            std::cerr << "[CONSUMER] Failed to make socket non-blocking, staying in blocking mode" << std::endl;
+            return;
+        }
+        if (options.mode == ReceiveMode::Epoll) {
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = sockfd;
+            if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sockfd, &event) < 0) {
+                std::cerr << "[CONSUMER] Failed to set up epoll, falling back to busy polling" << std::endl;
+                active_mode = ReceiveMode::BusyPoll;
+                return;
+            }
+        } else if (options.busy_poll_usec > 0 &&
+                   setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &options.busy_poll_usec, sizeof(options.busy_poll_usec)) < 0) {
+            // Raising SO_BUSY_POLL above net.core.busy_read needs CAP_NET_ADMIN
+            std::cerr << "[CONSUMER] SO_BUSY_POLL not permitted (" << strerror(errno)
+                      << "), spinning in user space only" << std::endl;
+        }
+        active_mode = options.mode;
+    }
+
+    // Pops the next complete frame off recv_buffer into `out`.
+    bool takeFrame(StompMessage& out) {
+        StompFrameView frame;
+        ParseResult result = parseStompFrame(recv_buffer.readPtr(), recv_buffer.readable(), frame);
+        if (result.status != ParseStatus::Complete) {
+            recv_buffer.consume(result.consumed);
+            if (result.status == ParseStatus::Malformed) {
+                std::cerr << "[CONSUMER] Dropping malformed STOMP data" << std::endl;
+                recv_buffer.clear();
+            }
+            return false;
+        }
+        if (capture != nullptr) {
+            capture->record(CaptureDirection::Received, frame);
+        }
+        size_t frame_start = frame.command.data() - recv_buffer.readPtr();
+        out.assign(recv_buffer.readPtr() + frame_start, result.consumed - frame_start);
+        recv_buffer.consume(result.consumed);
+        return true;
+    }
 
 public:
-    SimpleStompClient(const std::string& h, int p) : host(h), port(p), connected(false), sockfd(-1) {}
+    SimpleStompClient(const std::string& h, int p, const ReceiveOptions& receive_options = ReceiveOptions())
+        : host(h), port(p), connected(false), sockfd(-1), options(receive_options),
+          active_mode(ReceiveMode::Blocking), epoll_fd(-1), last_rx_timestamp_ns(0) {}
     
     ~SimpleStompClient() {
         disconnect();
     }
 
+    // Records every frame written and read; set before connect().
+    void setCapture(FrameCapture* frame_capture) { capture = frame_capture; }
+
     bool connect() {
+        // The ring is mapped once and reused across reconnects
+        if (!recv_buffer.valid()) {
+            if (!recv_buffer.allocate(options.buffer_size, options.huge_pages)) {
+                std::cerr << "Error mapping " << options.buffer_size << " byte receive ring buffer" << std::endl;
+                return false;
+            }
+            if (recv_buffer.backingPages() != options.huge_pages) {
+                std::cerr << "[CONSUMER] " << hugePageModeName(options.huge_pages) << " huge pages unavailable, receive buffer uses "
+                          << hugePageModeName(recv_buffer.backingPages()) << " pages" << std::endl;
+            }
+        }
+
         // Create socket
         sockfd = socket(AF_INET, SOCK_STREAM, 0);
         if (sockfd < 0) {
@@ -32,6 +264,10 @@ public:
             return false;
         }
 
+        // Kernel receive timestamps feed the kernel-to-handler latency histogram
+        int enable = 1;
+        setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+
         // Set up server address
         struct sockaddr_in server_addr;
         memset(&server_addr, 0, sizeof(server_addr));
@@ -55,51 +291,66 @@ public:
         }
 
         // Send STOMP CONNECT frame
-        std::string connectFrame = "CONNECT\n";
-        connectFrame += "accept-version:1.0,1.1,1.2\n";
-        connectFrame += "host:" + host + "\n";
-        connectFrame += "heart-beat:0,0\n";
-        connectFrame += "\n";
-        connectFrame += char(0); // null terminator
-
-        if (send(sockfd, connectFrame.c_str(), connectFrame.length(), 0) < 0) {
+        PooledBuffer connectFrame = StompFrameBuilder("CONNECT")
+            .header("accept-version", "1.0,1.1,1.2")
+            .header("host", host)
+            .header("heart-beat", "0,0")
+            .finish();
+        if (capture != nullptr) {
+            capture->record(CaptureDirection::Sent, connectFrame);
+        }
+
+        if (send(sockfd, connectFrame.data(), connectFrame.size(), 0) < 0) {
             std::cerr << "Error sending CONNECT frame" << std::endl;
             close(sockfd);
             return false;
         }
 
         // Read response
-        char buffer[1024];
-        int bytes_read = recv(sockfd, buffer, sizeof(buffer), 0);
-        if (bytes_read > 0) {
-            buffer[bytes_read] = '\0';
-            std::string response(buffer);
-            if (response.find("CONNECTED") != std::string::npos) {
-                connected = true;
-                std::cout << "[CONSUMER] Successfully connected to ActiveMQ via STOMP" << std::endl;
-                return true;
+        recv_buffer.clear();
+        StompMessage response;
+        while (fillReceiveBuffer()) {
+            if (takeFrame(response)) {
+                break;
             }
         }
+        if (response.command() == "CONNECTED") {
+            connected = true;
+            std::string_view version = response.header("version");
+            stomp_version = version.empty() ? "1.0" : std::string(version);
+            configureReceiveMode();
+            std::cout << "[CONSUMER] Successfully connected to ActiveMQ via STOMP" << std::endl;
+            return true;
+        }
 
         std::cerr << "Failed to receive CONNECTED frame" << std::endl;
         close(sockfd);
         return false;
     }
 
-    bool subscribe(const std::string& destination, const std::string& subscription_id = "sub-1") {
+    // A non-empty `selector` is sent as the SUBSCRIBE selector header so the
+    // broker filters before delivery. With ack_mode "client-individual" every
+    // MESSAGE must be settled through acknowledge().
+    bool subscribe(const std::string& destination, const std::string& subscription_id = "sub-1",
+                   const std::string& selector = "", const std::string& ack_mode = "auto") {
         if (!connected) {
             std::cerr << "Not connected to broker" << std::endl;
             return false;
         }
 
-        std::string subscribeFrame = "SUBSCRIBE\n";
-        subscribeFrame += "destination:" + destination + "\n";
-        subscribeFrame += "id:" + subscription_id + "\n";
-        subscribeFrame += "ack:auto\n";
-        subscribeFrame += "\n";
-        subscribeFrame += char(0); // null terminator
+        StompFrameBuilder builder("SUBSCRIBE");
+        builder.header("destination", destination)
+            .header("id", subscription_id)
+            .header("ack", ack_mode);
+        if (!selector.empty()) {
+            builder.escapedHeader("selector", selector);
+        }
+        PooledBuffer subscribeFrame = builder.finish();
+        if (capture != nullptr) {
+            capture->record(CaptureDirection::Sent, subscribeFrame);
+        }
 
-        if (send(sockfd, subscribeFrame.c_str(), subscribeFrame.length(), 0) < 0) {
+        if (send(sockfd, subscribeFrame.data(), subscribeFrame.size(), 0) < 0) {
             std::cerr << "Error sending SUBSCRIBE frame" << std::endl;
             return false;
         }
@@ -108,122 +359,798 @@ public:
         return true;
     }
 
-    std::string receiveMessage() {
+    // Fills `message` with the next MESSAGE frame. Frames already buffered
+    // are returned first; otherwise at most one recv() is issued.
+    bool receiveMessage(StompMessage& message) {
         if (!connected) {
-            return "";
+            return false;
         }
 
-        char buffer[4096];
-        int bytes_read = recv(sockfd, buffer, sizeof(buffer) - 1, 0);
-        
-        if (bytes_read > 0) {
-            buffer[bytes_read] = '\0';
-            std::string response(buffer);
-            
-            // Parse STOMP MESSAGE frame
-            if (response.find("MESSAGE") != std::string::npos) {
-                // Find the start of the message body (after double newline)
-                size_t body_start = response.find("\n\n");
-                if (body_start != std::string::npos) {
-                    body_start += 2;  // Skip the double newline
-                    size_t body_end = response.find('\0', body_start);
-                    if (body_end != std::string::npos) {
-                        return response.substr(body_start, body_end - body_start);
-                    } else {
-                        // If no null terminator found, take rest of string
-                        return response.substr(body_start);
-                    }
+        for (bool did_read = false;;) {
+            while (takeFrame(message)) {
+                if (message.command() == "MESSAGE") {
+                    return true;
+                }
+                if (message.command() == "ERROR") {
+                    std::cerr << "[CONSUMER] Broker sent ERROR: " << message.header("message") << std::endl;
                 }
             }
+            if (did_read || !fillReceiveBuffer()) {
+                message.clear();
+                return false;
+            }
+            did_read = true;
         }
-        
-        return "";
     }
 
+    // Reads once and hands every complete MESSAGE frame to `on_message` as a
+    // view into the receive ring (contiguous even across the wrap point); the
+    // views are only valid for the duration of the call.
+    // Returns the number of messages delivered.
+    template <typename Handler>
+    size_t receiveBatch(Handler&& on_message) {
+        if (!connected || !fillReceiveBuffer()) {
+            return 0;
+        }
+
+        size_t delivered = 0;
+        size_t offset = 0;
+        const char* data = recv_buffer.readPtr();
+        size_t available = recv_buffer.readable();
+        StompFrameView frame;
+        for (;;) {
+            ParseResult result = parseStompFrame(data + offset, available - offset, frame);
+            if (result.status == ParseStatus::Malformed) {
+                std::cerr << "[CONSUMER] Dropping malformed STOMP data" << std::endl;
+                offset = available;
+                break;
+            }
+            offset += result.consumed;
+            if (result.status == ParseStatus::Incomplete) {
+                break;
+            }
+            if (capture != nullptr) {
+                capture->record(CaptureDirection::Received, frame);
+            }
+            if (frame.command == "MESSAGE") {
+                on_message(frame);
+                ++delivered;
+            } else if (frame.command == "ERROR") {
+                std::cerr << "[CONSUMER] Broker sent ERROR: " << frame.header("message") << std::endl;
+            }
+        }
+        recv_buffer.consume(offset);
+        return delivered;
+    }
+
+    // ACK/NACK one message. May be called from inside a receiveBatch() handler.
+    bool acknowledge(std::string_view ack_id, std::string_view subscription, bool accepted) override {
+        if (!connected) {
+            return false;
+        }
+        TRACE_SCOPE(accepted ? "ack" : "nack");
+        // STOMP 1.2 acks by the MESSAGE's ack header alone; 1.0/1.1 by
+        // message-id, which 1.1 qualifies with the subscription
+        StompFrameBuilder builder(accepted ? "ACK" : "NACK");
+        if (stomp_version == "1.2") {
+            builder.header("id", ack_id);
+        } else {
+            builder.header("message-id", ack_id);
+            if (!subscription.empty()) {
+                builder.header("subscription", subscription);
+            }
+        }
+        PooledBuffer frame = builder.finish();
+        if (capture != nullptr) {
+            capture->record(CaptureDirection::Sent, frame);
+        }
+        const char* data = frame.data();
+        size_t remaining = frame.size();
+        while (remaining > 0) {
+            ssize_t written = send(sockfd, data, remaining, MSG_NOSIGNAL);
+            if (written >= 0) {
+                data += written;
+                remaining -= static_cast<size_t>(written);
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                pollfd pfd{sockfd, POLLOUT, 0};
+                poll(&pfd, 1, options.poll_timeout_ms);
+            } else if (errno != EINTR) {
+                std::cerr << "[CONSUMER] Error sending " << (accepted ? "ACK" : "NACK") << ": " << strerror(errno) << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ReceiveMode receiveMode() const { return active_mode; }
+
+    // True if the last read returned because of the receive timeout.
+    bool lastReadTimedOut() const { return last_read_timed_out; }
+
+    // Kernel (SO_TIMESTAMPNS) time of the last read, 0 if unavailable.
+    uint64_t lastReceiveTimestampNs() const { return last_rx_timestamp_ns; }
+
     void disconnect() {
         if (connected && sockfd >= 0) {
-            std::string disconnectFrame = "DISCONNECT\n\n";
-            disconnectFrame += char(0); // null terminator
-            send(sockfd, disconnectFrame.c_str(), disconnectFrame.length(), 0);
+            PooledBuffer disconnectFrame = StompFrameBuilder("DISCONNECT").finish();
+            if (capture != nullptr) {
+                capture->record(CaptureDirection::Sent, disconnectFrame);
+            }
+            send(sockfd, disconnectFrame.data(), disconnectFrame.size(), 0);
             close(sockfd);
+            if (epoll_fd >= 0) {
+                close(epoll_fd);
+                epoll_fd = -1;
+            }
             connected = false;
             std::cout << "[CONSUMER] Disconnected from ActiveMQ" << std::endl;
         }
     }
 };
 
-int main() {
+// Settings that SIGHUP or POST /reload can change while the consumer runs.
+struct LiveSettings {
+    LogLevel log_level = LogLevel::Info;
+    RedeliveryOptions redelivery;  // mode is fixed at startup
+};
+
+// Used at startup and on every reload.
+LiveSettings readLiveSettings(Config& config) {
+    LiveSettings settings;
+    RedeliveryOptions& redelivery = settings.redelivery;
+    config.beginReloadable();
+    if (!parseLogLevel(config.getString("log-level", logLevelName(settings.log_level), "debug, info, warn or error"),
+                       settings.log_level)) {
+        config.reject("log-level", "debug, info, warn or error");
+    }
+    redelivery.max_attempts = static_cast<int>(
+        config.getInt("max-attempts", redelivery.max_attempts, "handler runs before dead-lettering", 1, 1000));
+    redelivery.initial_delay =
+        config.getMillis("redelivery-delay", redelivery.initial_delay, "delay before the first retry");
+    redelivery.backoff_multiplier =
+        config.getDouble("redelivery-backoff", redelivery.backoff_multiplier, "delay multiplier per retry");
+    redelivery.max_delay = config.getMillis("redelivery-max-delay", redelivery.max_delay, "upper bound on the retry delay");
+    redelivery.dead_letter_destination = config.getString(
+        "dead-letter-destination", redelivery.dead_letter_destination, "where exhausted messages are sent");
+    config.endReloadable();
+    return settings;
+}
+
+// When a message was produced: the producer's sent-at-ns, else the broker's
+// millisecond `timestamp` header; 0 if neither is present.
+uint64_t producedAtNs(const StompFrameView& frame) {
+    uint64_t value = 0;
+    std::string_view sent_at = frame.header("sent-at-ns");
+    if (!sent_at.empty() && std::from_chars(sent_at.data(), sent_at.data() + sent_at.size(), value).ec == std::errc()) {
+        return value;
+    }
+    std::string_view timestamp = frame.header("timestamp");
+    if (!timestamp.empty() &&
+        std::from_chars(timestamp.data(), timestamp.data() + timestamp.size(), value).ec == std::errc()) {
+        return value * 1'000'000;
+    }
+    return 0;
+}
+
+// The coroutine client has no receive loop to beat /healthz from; this timer
+// shows the event loop still comes round while no messages arrive. It stops
+// within one interval of `consuming` going false.
+Task<void> beatWhileConsuming(EventLoop& loop, HealthMonitor& health, const bool& consuming) {
+    while (consuming) {
+        health.receiveBeat();
+        co_await loop.sleepFor(health.beatInterval());
+    }
+}
+
+// Same flow as main() on the coroutine client: each co_await sub->next()
+// parks the coroutine until the read loop routes a MESSAGE to it.
+// `consuming` must outlive the loop's run(), as beatWhileConsuming() reads it.
+Task<void> runAsyncConsumer(EventLoop& loop, const BrokerSettings& broker, const std::string& destination,
+                            int expected_messages, const RcuSnapshot<LiveSettings>& live, SpanExporter& spans,
+                            HealthMonitor& health, FrameCapture* capture, bool& consuming, int& exit_code) {
+    AsyncStompClient client(loop, broker.host, broker.port);
+    client.setCapture(capture);
+    bool connected = false;
+    for (int retry = 1; retry <= broker.max_retries && !connected; ++retry) {
+        std::cout << "[CONSUMER] Connection attempt " << retry << "/" << broker.max_retries << std::endl;
+        connected = co_await client.connect();
+        if (!connected && retry < broker.max_retries) {
+            std::cout << "[CONSUMER] Retrying in " << broker.retry_interval.count() << " ms..." << std::endl;
+            co_await loop.sleepFor(broker.retry_interval);
+        }
+    }
+    if (!connected) {
+        std::cerr << "[CONSUMER] Failed to connect to ActiveMQ after " << broker.max_retries << " attempts" << std::endl;
+        co_return;
+    }
+    Subscription* sub = co_await client.subscribe(destination);
+    if (sub == nullptr) {
+        std::cerr << "[CONSUMER] Failed to subscribe to " << destination << std::endl;
+        co_return;
+    }
+    std::cout << "[CONSUMER] Waiting for messages from " << destination << " (async client)" << std::endl;
+    health.setReady(true);
+    consuming = true;
+    loop.spawn(beatWhileConsuming(loop, health, consuming));
+
+    int messages_received = 0;
+    int expired_messages = 0;  // counted as settled, like the receive loop does
+    while (messages_received + expired_messages < expected_messages) {
+        StompMessage message = co_await sub->next();
+        health.receiveBeat();
+        if (message.empty()) {
+            std::cerr << "[CONSUMER] Connection closed by broker" << std::endl;
+            break;
+        }
+        if (isExpired(message.view(), realtimeNs() / 1'000'000)) {
+            ++expired_messages;
+            continue;
+        }
+        uint64_t now_ns = realtimeNs();
+        ConsumerSpan span(spans, message.view(), now_ns);
+        health.recordMessage(producedAtNs(message.view()), now_ns);
+        messages_received++;
+        if (live.read().log_level <= LogLevel::Info) {
+            std::cout << "[CONSUMER] Received message " << messages_received << "/"
+                      << expected_messages << ": " << message.body() << std::endl;
+        }
+    }
+
+    std::cout << "[CONSUMER] Total messages received: " << messages_received << std::endl;
+    std::cout << "[CONSUMER] Expired messages dropped: " << expired_messages << std::endl;
+    health.setReady(false);
+    consuming = false;
+    co_await client.disconnect();
+    exit_code = messages_received + expired_messages == expected_messages ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
     std::cout << "[CONSUMER] Starting C++ Consumer Application" << std::endl;
-    
+
+    // Every knob below can be set with --key=value, CONSUMER_<KEY> or a
+    // config file (--config / CONSUMER_CONFIG); see --help.
+    Config config("CONSUMER");
+    std::string config_error;
+    if (!config.load(argc, argv, config_error)) {
+        std::cerr << "[CONSUMER] " << config_error << std::endl;
+        return 1;
+    }
+
     // Connection parameters
-    std::string broker_host = "activemq";  // Docker service name
-    int broker_port = 61613;  // STOMP port
-    std::string queue_destination = "/queue/ProjectQueue";
+    BrokerSettings broker;
+    broker.host = config.getString("broker-host", broker.host, "STOMP broker host name");
+    broker.port = static_cast<int>(config.getInt("broker-port", broker.port, "STOMP broker port", 1, 65535));
+    broker.max_retries = static_cast<int>(
+        config.getInt("connect-retries", broker.max_retries, "connection attempts before giving up", 1, 1'000'000));
+    broker.retry_interval = config.getMillis("retry-interval", broker.retry_interval, "wait between connection attempts");
+    // All destinations share one connection; each gets its own subscription
+    // id. Artemis wildcards ("orders.*", "news.#") are allowed.
+    std::vector<std::string> destinations =
+        config.getList("destinations", "/queue/ProjectQueue", "comma-separated destinations to subscribe to");
+    if (destinations.empty()) {
+        config.reject("destinations", "at least one destination");
+    }
+    const int expected_messages =
+        static_cast<int>(config.getInt("message-count", 10, "messages to receive before exiting", 0, 1'000'000'000));
+
+    ReceiveOptions receive_options;
+    // epoll / busy-poll trade CPU for wake-up latency
+    if (!parseReceiveMode(config.getString("receive-mode", "blocking", "blocking, epoll or busy-poll"),
+                          receive_options.mode)) {
+        config.reject("receive-mode", "blocking, epoll or busy-poll");
+    }
+    if (!parseSpinStrategy(config.getString("spin", "pause", "busy-poll spin strategy: pause, yield or none"),
+                           receive_options.spin)) {
+        config.reject("spin", "pause, yield or none");
+    }
+    receive_options.buffer_size =
+        config.getSize("buffer-size", receive_options.buffer_size, "receive ring buffer size");
+    receive_options.busy_poll_usec = static_cast<int>(config.getInt(
+        "busy-poll-usec", receive_options.busy_poll_usec, "SO_BUSY_POLL budget per recv, 0 to leave unset", 0,
+        1'000'000));
+    receive_options.poll_timeout_ms = static_cast<int>(config.getInt(
+        "poll-timeout-ms", receive_options.poll_timeout_ms, "receive wait per call in milliseconds", 1, 60'000));
+    if (!parseHugePageMode(
+            config.getString("huge-pages", "off", "receive ring and buffer pool huge pages: off, transparent or explicit"),
+            receive_options.huge_pages)) {
+        config.reject("huge-pages", "off, transparent or explicit");
+    }
+
+    // Thread-per-core mode: pin the I/O loop (and any later worker threads)
+    // to these CPUs, e.g. "2-3". Empty leaves scheduling to the kernel.
+    std::string cpu_list = config.getString("cpus", "", "CPU list to pin threads to, e.g. 2-3");
+    bool numa_local_buffers = config.getBool("numa-local-buffers", false, "bind thread memory to the local NUMA node");
+    std::vector<int> cpus;
+    if (!parseCpuList(cpu_list, cpus)) {
+        config.reject("cpus", "a CPU list like 0-3,8");
+    }
+
+    // Run the coroutine-based client instead of the receive loop below
+    const bool use_async_client =
+        config.getBool("async-client", false, "use the coroutine client instead of the receive loop");
+
+    // JMS selector applied to every subscription, e.g. "priority > 4". It is
+    // sent to the broker, and also evaluated here when filter_locally is set
+    // (brokers or destinations that ignore the selector header).
+    std::string selector = config.getString("selector", "", "JMS message selector for every subscription");
+    const bool filter_locally = config.getBool("filter-locally", false, "also evaluate the selector in the consumer");
+
+    // Failed messages are retried with backoff and, after max_attempts,
+    // published to the dead-letter queue over a separate connection. Needs
+    // client-individual acks so the broker only forgets settled messages, so
+    // it is opt-in; without it the subscription stays ack:auto.
+    const bool dead_letter_enabled =
+        config.getBool("dead-letter", false, "retry failed messages and dead-letter them");
+    // Log level and retry policy can be changed without a restart
+    RcuSnapshot<LiveSettings> live(readLiveSettings(config));
+    RedeliveryOptions redelivery_options = live.read().redelivery;
+    std::string redelivery_mode =
+        config.getString("redelivery-mode", "local", "retry locally (local) or via NACK (nack)");
+    if (redelivery_mode == "local") {
+        redelivery_options.mode = RedeliveryMode::LocalRetry;
+    } else if (redelivery_mode == "nack") {
+        redelivery_options.mode = RedeliveryMode::Nack;
+    } else {
+        config.reject("redelivery-mode", "local or nack");
+    }
+
+    // Priority processing: the I/O thread only copies MESSAGE frames into a
+    // per-priority queue and a worker thread runs expiry, dispatch,
+    // redelivery and ACKs, highest `priority` header first, so urgent
+    // messages overtake a backlog. Off runs handlers inline on the I/O thread.
+    const bool priority_processing =
+        config.getBool("priority-processing", false, "process messages on a worker thread by priority");
+    const size_t priority_queue_capacity =
+        config.getSize("priority-queue-capacity", 4096, "queued messages per priority level");
+    // Operator endpoint (POST /reload, GET /config); 0 disables it
+    const int admin_port = static_cast<int>(config.getInt("admin-port", 0, "admin HTTP port, 0 to disable", 0, 65535));
+    const std::string admin_address = config.getString("admin-address", "127.0.0.1", "admin HTTP bind address");
+    // /healthz fails once the receive loop (or worker) has been stuck this long
+    const std::chrono::milliseconds health_stall_timeout = config.getMillis(
+        "health-stall-timeout", std::chrono::milliseconds(30'000), "receive loop silence that fails /healthz");
+    // CPU profiling on demand through the admin port (POST /profile/start)
+    const bool profiler = config.getBool("profiler", false, "allow sampling profiles via the admin port");
+    const size_t profile_buffer = config.getSize("profile-buffer", 32768, "stacks kept per profile run");
+    // Records every frame on the broker connection, with timestamps, for
+    // offline replay (producer --replay-file). Empty disables capture.
+    const std::string capture_file = config.getString("capture-file", "", "record all frames to this file");
+    const size_t capture_chunk_size =
+        config.getSize("capture-chunk-size", 64 * 1024 * 1024, "capture file growth step");
+    // Per-stage trace points, exported as Chrome trace / Perfetto JSON on exit
+    const std::string trace_file = config.getString("trace-file", "", "write a Chrome trace of hot-path stages here");
+    const size_t trace_buffer =
+        config.getSize("trace-buffer", 65536, "trace events kept per thread (most recent win)");
+    if (!trace_file.empty() && !STOMP_TRACE) {
+        config.reject("trace-file", "a build with STOMP_TRACING=ON");
+    }
+    // A span per message that arrives with a sampled traceparent, as OTLP JSON lines
+    const std::string span_file = config.getString("span-file", "", "export OpenTelemetry spans to this file");
+    // The coroutine client consumes a single destination with ack:auto and
+    // none of the receive loop's filtering, retry or hand-off options
+    if (use_async_client) {
+        const char* threaded = "the receive loop (async-client=false)";
+        if (destinations.size() > 1) {
+            config.reject("destinations", "a single destination with async-client");
+        }
+        if (!selector.empty()) {
+            config.reject("selector", threaded);
+        }
+        if (filter_locally) {
+            config.reject("filter-locally", threaded);
+        }
+        if (dead_letter_enabled) {
+            config.reject("dead-letter", threaded);
+        }
+        if (priority_processing) {
+            config.reject("priority-processing", threaded);
+        }
+    }
+
+    if (config.helpRequested()) {
+        config.printHelp(std::cout);
+        return 0;
+    }
+    if (!config.validate(config_error)) {
+        std::cerr << "[CONSUMER] Invalid configuration: " << config_error << std::endl;
+        return 1;
+    }
+    config.print(std::cout, "[CONSUMER]");
+
+    // SIGHUP and POST /reload re-read the config file and publish a new
+    // LiveSettings snapshot; other changed keys are reported, not applied.
+    std::mutex reload_mutex;  // Config is not thread-safe
+    std::atomic<RedeliveryManager*> active_redelivery{nullptr};
+    auto reload = [&]() -> std::string {
+        std::lock_guard<std::mutex> lock(reload_mutex);
+        std::string error;
+        std::vector<std::string> restart_required;
+        if (!config.reload(error, restart_required)) {
+            return "reload failed: " + error;
+        }
+        LiveSettings next = readLiveSettings(config);
+        if (!config.validate(error)) {
+            config.rollback();
+            return "reload rejected: " + error;
+        }
+        if (RedeliveryManager* manager = active_redelivery.load(std::memory_order_acquire)) {
+            manager->updateOptions(next.redelivery);
+        }
+        live.publish(next);
+        std::string result = "reloaded (version " + std::to_string(live.version()) + ")";
+        for (const std::string& key : restart_required) {
+            result += "; " + key + " needs a restart";
+        }
+        return result;
+    };
+    ReloadSignal reload_signal([&] { std::cout << "[CONSUMER] SIGHUP: " << reload() << std::endl; });
+    reload_signal.start();
+    HealthMonitor health(health_stall_timeout);
+    AdminServer admin;
+    health.addRoutes(admin);
+    admin.route("POST", "/reload",
+                [&](const AdminRequest&) { return AdminResponse{200, "text/plain", reload() + "\n"}; });
+    admin.route("GET", "/config", [&](const AdminRequest&) {
+        std::lock_guard<std::mutex> lock(reload_mutex);
+        std::ostringstream out;
+        config.print(out, "");
+        return AdminResponse{200, "text/plain", out.str()};
+    });
+    if (profiler) {
+        addProfileRoutes(admin, profile_buffer);
+    }
+    if (admin_port != 0 && !admin.start(admin_address, admin_port)) {
+        std::cerr << "[CONSUMER] Cannot listen on admin port " << admin_address << ":" << admin_port << std::endl;
+        return 1;
+    }
+
+    FrameCapture capture;
+    if (!capture_file.empty()) {
+        std::string error;
+        if (!capture.open(capture_file, capture_chunk_size, error)) {
+            std::cerr << "[CONSUMER] " << error << std::endl;
+            return 1;
+        }
+        std::cout << "[CONSUMER] Capturing frames to " << capture_file << std::endl;
+    }
+    if (!trace_file.empty()) {
+        Tracer::instance().enable(trace_buffer);
+    }
+    SpanExporter spans("consumer");
+    if (!span_file.empty()) {
+        std::string error;
+        if (!spans.start(span_file, error)) {
+            std::cerr << "[CONSUMER] " << error << std::endl;
+            return 1;
+        }
+    }
+    auto finish_spans = [&] {
+        if (!span_file.empty()) {
+            spans.stop();
+            std::cout << "[CONSUMER] Exported " << spans.exportedCount() << " spans to " << span_file << " ("
+                      << spans.droppedCount() << " dropped)" << std::endl;
+        }
+    };
+    auto finish_trace = [&] {
+        if (trace_file.empty()) {
+            return;
+        }
+        std::string error;
+        if (Tracer::instance().writeChromeTrace(trace_file, error)) {
+            std::cout << "[CONSUMER] Wrote trace of " << Tracer::instance().threadCount() << " thread(s) to " << trace_file
+                      << " (" << Tracer::instance().droppedEvents() << " events overwritten)" << std::endl;
+        } else {
+            std::cerr << "[CONSUMER] " << error << std::endl;
+        }
+    };
+    auto finish_capture = [&] {
+        if (capture.isOpen()) {
+            capture.close();
+            std::cout << "[CONSUMER] Captured " << capture.recordCount() << " frames (" << capture.bytesWritten()
+                      << " bytes, " << capture.droppedCount() << " dropped) to " << capture_file << std::endl;
+        }
+    };
+
+    BufferPool::instance().setHugePageMode(receive_options.huge_pages);
+    CoreRuntime runtime(cpus, numa_local_buffers);
+    CoreStats& io_stats = runtime.attachCurrentThread("io");
+
+    if (use_async_client) {
+        EventLoop loop;
+        int exit_code = 1;
+        bool consuming = false;
+        loop.spawn(runAsyncConsumer(loop, broker, destinations.front(), expected_messages, live, spans, health,
+                                    capture.isOpen() ? &capture : nullptr, consuming, exit_code));
+        loop.run();
+        finish_capture();
+        finish_trace();
+        finish_spans();
+        if (exit_code == 0) {
+            std::cout << "[CONSUMER] Consumer application completed successfully" << std::endl;
+        }
+        return exit_code;
+    }
     
     // Retry connection logic to handle broker startup delays
-    SimpleStompClient client(broker_host, broker_port);
+    SimpleStompClient client(broker.host, broker.port, receive_options);
+    client.setCapture(capture.isOpen() ? &capture : nullptr);
     bool connection_successful = false;
-    int max_retries = 10;
-    
-    for (int retry = 1; retry <= max_retries; ++retry) {
-        std::cout << "[CONSUMER] Connection attempt " << retry << "/" << max_retries << std::endl;
+
+    for (int retry = 1; retry <= broker.max_retries; ++retry) {
+        std::cout << "[CONSUMER] Connection attempt " << retry << "/" << broker.max_retries << std::endl;
         
         if (client.connect()) {
             connection_successful = true;
             break;
         }
         
-        if (retry < max_retries) {
-            std::cout << "[CONSUMER] Retrying in 3 seconds..." << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(3));
+        if (retry < broker.max_retries) {
+            std::cout << "[CONSUMER] Retrying in " << broker.retry_interval.count() << " ms..." << std::endl;
+            std::this_thread::sleep_for(broker.retry_interval);
         }
     }
     
     if (!connection_successful) {
-        std::cerr << "[CONSUMER] Failed to connect to ActiveMQ after " << max_retries << " attempts" << std::endl;
-        return 1;
-    }
-    
-    // Subscribe to the queue
-    if (!client.subscribe(queue_destination)) {
-        std::cerr << "[CONSUMER] Failed to subscribe to " << queue_destination << std::endl;
+        std::cerr << "[CONSUMER] Failed to connect to ActiveMQ after " << broker.max_retries << " attempts" << std::endl;
         return 1;
     }
     
     // Receive messages
-    const int expected_messages = 10;
-    int messages_received = 0;
+    std::atomic<int> messages_received{0};
     
-    std::cout << "[CONSUMER] Waiting for messages from " << queue_destination << std::endl;
+    // Everything decoded from one receive batch lives in this arena and is
+    // released in one step once the batch has been processed.
+    MonotonicArena batch_arena(64 * 1024);
+    // kernel-to-handler: SO_TIMESTAMPNS of the read -> handler entry (local clock only)
+    // end-to-end: producer's sent-at-ns header -> handler entry (needs synced clocks)
+    // scheduled end-to-end: intended-at-ns (open-loop producers only) -> handler
+    // entry, which also counts time a message waited to be sent
+    LatencyHistogram kernel_to_handler_latency;
+    LatencyHistogram end_to_end_latency;
+    LatencyHistogram scheduled_end_to_end_latency;
+    // Set by whichever thread runs the handlers (the I/O thread, or the
+    // worker when priority_processing is on)
+    uint64_t handler_rx_ns = 0;
+    CoreStats* handler_stats = &io_stats;
+
+    // Handlers reject a message by throwing; see the redelivery settings below
+    auto handle_message = [&](const StompFrameView& frame) {
+        if (messages_received >= expected_messages) {
+            return;
+        }
+        TRACE_SCOPE_ARG("handler", frame.body.size());
+        uint64_t now_ns = realtimeNs();
+        // Submitted when the handler returns, or marked failed if it throws
+        ConsumerSpan span(spans, frame, handler_rx_ns != 0 ? handler_rx_ns : now_ns);
+        if (handler_rx_ns != 0 && now_ns >= handler_rx_ns) {
+            kernel_to_handler_latency.record(now_ns - handler_rx_ns);
+        }
+        std::string_view sent_at = frame.header("sent-at-ns");
+        uint64_t sent_ns = 0;
+        if (std::from_chars(sent_at.data(), sent_at.data() + sent_at.size(), sent_ns).ec == std::errc() &&
+            now_ns >= sent_ns) {
+            end_to_end_latency.record(now_ns - sent_ns);
+            // Producer send to kernel receive: network plus broker time
+            TRACE_WALL_SPAN("broker", sent_ns, handler_rx_ns != 0 ? handler_rx_ns : now_ns, frame.body.size());
+        }
+        health.recordMessage(sent_ns != 0 ? sent_ns : producedAtNs(frame), now_ns);
+        std::string_view intended_at = frame.header("intended-at-ns");
+        uint64_t intended_ns = 0;
+        if (!intended_at.empty() &&
+            std::from_chars(intended_at.data(), intended_at.data() + intended_at.size(), intended_ns).ec ==
+                std::errc() &&
+            now_ns >= intended_ns) {
+            scheduled_end_to_end_latency.record(now_ns - intended_ns);
+        }
+        DecodedMessage message(&batch_arena);
+        {
+            TRACE_SCOPE_ARG("decode", frame.body.size());
+            decodeMessage(frame, message);
+        }
+
+        messages_received++;
+        handler_stats->record(frame.body.size());
+        if (live.read().log_level <= LogLevel::Info) {
+            std::cout << "[CONSUMER] Received message " << messages_received << "/"
+                      << expected_messages << ": " << message.body << std::endl;
+            if (message.is_json) {
+                std::cout << "[CONSUMER]   JSON payload with " << message.fields.size() << " fields" << std::endl;
+            }
+        }
+    };
+
+    Selector local_filter;
+    if (!selector.empty()) {
+        std::string error;
+        if (!local_filter.compile(selector, error)) {
+            std::cerr << "[CONSUMER] Invalid selector '" << selector << "': " << error << std::endl;
+            return 1;
+        }
+    }
+
+    DeadLetterPublisher dead_letters(broker.host, broker.port);  // connects on the first dead letter
+    RedeliveryManager redelivery(client, dead_letters, redelivery_options);
+    active_redelivery.store(&redelivery, std::memory_order_release);
+    if (dead_letter_enabled) {
+        dead_letters.start();
+    }
+    // Frames are routed once, by the subscription id they arrived on, so
+    // overlapping wildcard subscriptions never run a delivery twice and the
+    // broker's spelling of the destination does not matter
+    const RedeliveryManager::Handler run_handler = handle_message;
+    RedeliveryManager::Handler on_subscription = run_handler;
+    if (dead_letter_enabled) {
+        on_subscription = [&](const StompFrameView& frame) { redelivery.process(frame, run_handler); };
+    }
+
+    // Subscribe to every destination
+    SubscriptionTable subscriptions;
+    for (const std::string& destination : destinations) {
+        const std::string& id = subscriptions.add(destination, on_subscription,
+                                                  filter_locally ? local_filter : Selector());
+        if (!client.subscribe(destination, id, selector, dead_letter_enabled ? "client-individual" : "auto")) {
+            std::cerr << "[CONSUMER] Failed to subscribe to " << destination << std::endl;
+            return 1;
+        }
+    }
+    
+    std::cout << "[CONSUMER] Waiting for messages from " << destinations.size() << " destination(s)" << std::endl;
     std::cout << "[CONSUMER] Expected to receive " << expected_messages << " messages" << std::endl;
+    health.setReady(true);
     
-    while (messages_received < expected_messages) {
-        std::string message = client.receiveMessage();
-        
-        if (!message.empty()) {
-            messages_received++;
-            std::cout << "[CONSUMER] Received message " << messages_received << "/" 
-                      << expected_messages << ": " << message << std::endl;
-            
-            // TODO: This is the ideal place to deserialize future JSON payloads
-            // For now, we're processing simple string messages
-            
-            if (messages_received >= expected_messages) {
-                std::cout << "[CONSUMER] All " << expected_messages 
-                          << " messages received successfully!" << std::endl;
+    // Messages past their `expires` header are dropped (and ACKed) before
+    // decoding, so a backlog catch-up never spends time on stale work.
+    int expired_messages = 0;
+    auto settled = [&] {
+        RedeliveryStats retry_stats = redelivery.stats();
+        return messages_received + expired_messages + static_cast<int>(retry_stats.dead_lettered + retry_stats.expired);
+    };
+    auto process_frame = [&](const StompFrameView& frame) {
+        if (isExpired(frame, realtimeNs() / 1'000'000)) {
+            ++expired_messages;
+            if (dead_letter_enabled) {
+                client.acknowledge(RedeliveryManager::ackId(frame), frame.header("subscription"), true);
+            }
+            return;
+        }
+        TRACE_SCOPE("dispatch");
+        if (!subscriptions.dispatch(frame)) {
+            std::cerr << "[CONSUMER] No handler for subscription '" << frame.header("subscription") << "'" << std::endl;
+        }
+    };
+
+    PriorityMessageQueue work_queue(priority_queue_capacity);
+    if (priority_processing) {
+        health.attachQueue(&work_queue);
+    }
+    std::array<LatencyHistogram, PriorityMessageQueue::kLevels> priority_wait_latency;  // worker only
+    std::atomic<bool> all_settled{false};
+    std::thread worker;
+    if (priority_processing) {
+        worker = runtime.spawn("worker", [&](CoreStats& stats) {
+            handler_stats = &stats;
+            QueuedMessage item;
+            while (!all_settled.load(std::memory_order_acquire)) {
+                health.workerBeat();
+                if (dead_letter_enabled) {
+                    redelivery.poll(run_handler);
+                    health.setPendingRetries(redelivery.stats().pending);
+                }
+                if (!work_queue.pop(item, std::chrono::milliseconds(receive_options.poll_timeout_ms))) {
+                    if (work_queue.closed()) {
+                        break;
+                    }
+                    continue;
+                }
+                priority_wait_latency[item.priority].record(monotonicNs() - item.enqueued_ns);
+                handler_rx_ns = item.rx_ns;
+                process_frame(item.message.view());
+                item.message.clear();
+                batch_arena.reset();
+                if (settled() >= expected_messages) {
+                    all_settled.store(true, std::memory_order_release);
+                }
+            }
+            // Releases an I/O thread spinning in push() on a full level
+            work_queue.close();
+        });
+    }
+
+    while (!all_settled.load(std::memory_order_acquire)) {
+        health.receiveBeat();
+        if (dead_letter_enabled && !priority_processing) {
+            redelivery.poll(run_handler);
+            health.setPendingRetries(redelivery.stats().pending);
+        }
+        size_t batch_size = client.receiveBatch([&](const StompFrameView& frame) {
+            if (priority_processing) {
+                TRACE_SCOPE("enqueue");
+                if (work_queue.push(frame, client.lastReceiveTimestampNs())) {
+                    return;
+                }
+                // The worker has stopped: hand the message back to the
+                // broker, or handle it here when it is already auto-acked
+                if (dead_letter_enabled) {
+                    client.acknowledge(RedeliveryManager::ackId(frame), frame.header("subscription"), false);
+                    return;
+                }
+            }
+            handler_rx_ns = client.lastReceiveTimestampNs();
+            process_frame(frame);
+        });
+        if (!priority_processing) {
+            batch_arena.reset();
+            if (settled() >= expected_messages) {
+                all_settled.store(true, std::memory_order_release);
                 break;
             }
-        } else {
+        }
+        if (batch_size == 0 && client.receiveMode() == ReceiveMode::Blocking && !client.lastReadTimedOut()) {
             // Small delay to prevent busy waiting
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
     }
-    
+    health.setReady(false);
+    if (worker.joinable()) {
+        work_queue.close();
+        worker.join();
+    }
+    if (settled() >= expected_messages) {
+        std::cout << "[CONSUMER] All " << expected_messages
+                  << " messages received successfully!" << std::endl;
+    }
+
     std::cout << "[CONSUMER] Total messages received: " << messages_received << std::endl;
+    std::cout << "[CONSUMER] Expired messages dropped: " << expired_messages << std::endl;
+    for (size_t i = 0; i < subscriptions.size(); ++i) {
+        std::cout << "[CONSUMER]   " << subscriptions.at(i).destination << ": "
+                  << subscriptions.at(i).delivered << " messages, "
+                  << subscriptions.at(i).filtered << " filtered by selector" << std::endl;
+    }
+    if (dead_letter_enabled) {
+        RedeliveryStats retry_stats = redelivery.stats();
+        std::cout << "[CONSUMER] Redelivery: " << retry_stats.failures << " failures, " << retry_stats.retries
+                  << " retries, " << retry_stats.dead_lettered << " dead-lettered, " << retry_stats.expired
+                  << " expired, " << retry_stats.pending
+                  << " pending" << std::endl;
+    }
     std::cout << "[CONSUMER] Shutting down gracefully..." << std::endl;
     
+    admin.stop();
+    if (profiler) {
+        SamplingProfiler::instance().stop();
+    }
+    reload_signal.stop();
+    active_redelivery.store(nullptr, std::memory_order_release);
+    dead_letters.stop();
     client.disconnect();
+    finish_capture();
+    finish_trace();
+    finish_spans();
+
+    BufferPoolStats pool_stats = BufferPool::instance().stats();
+    std::cout << "[CONSUMER] Buffer pool hit rate: " << std::fixed << std::setprecision(1)
+              << pool_stats.hitRate() * 100.0 << "%, bytes outstanding: "
+              << pool_stats.bytes_outstanding << ", huge page slabs: " << pool_stats.huge_slab_bytes
+              << "/" << pool_stats.slab_bytes << " bytes" << std::endl;
+    std::string mode_name = receiveModeName(client.receiveMode());
+    kernel_to_handler_latency.print(std::cout, "[CONSUMER]", (mode_name + " kernel-to-handler").c_str());
+    end_to_end_latency.print(std::cout, "[CONSUMER]", (mode_name + " end-to-end").c_str());
+    if (scheduled_end_to_end_latency.count() > 0) {
+        scheduled_end_to_end_latency.print(std::cout, "[CONSUMER]",
+                                           (mode_name + " end-to-end from intended send time").c_str());
+    }
+    for (int priority = PriorityMessageQueue::kLevels - 1; priority >= 0; --priority) {
+        if (priority_wait_latency[priority].count() > 0) {
+            priority_wait_latency[priority].print(std::cout, "[CONSUMER]",
+                                                  ("priority " + std::to_string(priority) + " queue wait").c_str());
+        }
+    }
+    std::cout << "[CONSUMER] Batch arena high-water mark: " << batch_arena.highWaterMark()
+              << " of " << batch_arena.bytesReserved() << " bytes reserved" << std::endl;
     
+    io_stats.sampleScheduler();
+    runtime.report(std::cout, "[CONSUMER]");
+
     std::cout << "[CONSUMER] Consumer application completed successfully" << std::endl;
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "stomp_frame.hpp"
+
+// Everything decoded from one MESSAGE frame. All storage comes from the
+// memory resource passed to decodeMessage(), normally the per-batch arena,
+// and string_views may point either into that arena or into the frame.
+struct DecodedHeader {
+    std::string_view name;
+    std::string_view value;
+};
+
+struct JsonField {
+    std::string_view key;
+    std::string_view value;  // unescaped string contents, or raw token text
+    bool is_string;
+};
+
+struct DecodedMessage {
+    explicit DecodedMessage(std::pmr::memory_resource* resource)
+        : headers(resource), fields(resource) {}
+
+    std::pmr::vector<DecodedHeader> headers;
+    std::pmr::vector<JsonField> fields;  // top-level members of a JSON object body
+    std::string_view body;
+    bool is_json = false;
+
+    std::string_view header(std::string_view name) const {
+        for (const DecodedHeader& h : headers) {
+            if (h.name == name) {
+                return h.value;
+            }
+        }
+        return {};
+    }
+
+    std::string_view field(std::string_view key) const {
+        for (const JsonField& f : fields) {
+            if (f.key == key) {
+                return f.value;
+            }
+        }
+        return {};
+    }
+};
+
+// STOMP 1.2 header escapes (\r \n \c \\). Values without a backslash are
+// returned as-is; only escaped values are copied into the resource.
+inline std::string_view unescapeHeader(std::string_view raw, std::pmr::memory_resource* resource) {
+    if (raw.find('\\') == std::string_view::npos) {
+        return raw;
+    }
+    char* out = static_cast<char*>(resource->allocate(raw.size(), 1));
+    size_t len = 0;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (c == '\\' && i + 1 < raw.size()) {
+            switch (raw[++i]) {
+                case 'r': c = '\r'; break;
+                case 'n': c = '\n'; break;
+                case 'c': c = ':'; break;
+                default: c = raw[i]; break;
+            }
+        }
+        out[len++] = c;
+    }
+    return std::string_view(out, len);
+}
+
+// Minimal parser for a flat JSON object body: string members are unescaped
+// into the resource, any other value (numbers, literals, nested objects or
+// arrays) is kept as its raw text. Returns false if the body is not an object.
+class JsonFieldParser {
+public:
+    JsonFieldParser(std::string_view text, std::pmr::memory_resource* resource)
+        : text(text), resource(resource) {}
+
+    bool parse(std::pmr::vector<JsonField>& fields) {
+        skipSpace();
+        if (!consume('{')) {
+            return false;
+        }
+        skipSpace();
+        if (consume('}')) {
+            return true;
+        }
+        for (;;) {
+            JsonField field{};
+            skipSpace();
+            if (!parseString(field.key)) {
+                return false;
+            }
+            skipSpace();
+            if (!consume(':')) {
+                return false;
+            }
+            skipSpace();
+            if (peek() == '"') {
+                field.is_string = true;
+                if (!parseString(field.value)) {
+                    return false;
+                }
+            } else if (!skipValue(field.value)) {
+                return false;
+            }
+            fields.push_back(field);
+            skipSpace();
+            if (consume('}')) {
+                return true;
+            }
+            if (!consume(',')) {
+                return false;
+            }
+        }
+    }
+
+private:
+    char peek() const { return pos < text.size() ? text[pos] : '\0'; }
+
+    bool consume(char c) {
+        if (peek() != c) {
+            return false;
+        }
+        ++pos;
+        return true;
+    }
+
+    void skipSpace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            ++pos;
+        }
+    }
+
+    bool parseString(std::string_view& out) {
+        if (!consume('"')) {
+            return false;
+        }
+        size_t start = pos;
+        bool escaped = false;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\') {
+                escaped = true;
+                ++pos;
+            }
+            ++pos;
+        }
+        if (pos >= text.size()) {
+            return false;
+        }
+        std::string_view raw = text.substr(start, pos - start);
+        ++pos;
+        out = escaped ? unescape(raw) : raw;
+        return true;
+    }
+
+    // \uXXXX escapes are kept verbatim; everything else maps to one byte.
+    std::string_view unescape(std::string_view raw) {
+        char* out = static_cast<char*>(resource->allocate(raw.size(), 1));
+        size_t len = 0;
+        for (size_t i = 0; i < raw.size(); ++i) {
+            char c = raw[i];
+            if (c == '\\' && i + 1 < raw.size()) {
+                char e = raw[++i];
+                switch (e) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case 'u': out[len++] = '\\'; c = 'u'; break;
+                    default: c = e; break;
+                }
+            }
+            out[len++] = c;
+        }
+        return std::string_view(out, len);
+    }
+
+    bool skipValue(std::string_view& out) {
+        size_t start = pos;
+        int depth = 0;
+        bool in_string = false;
+        for (; pos < text.size(); ++pos) {
+            char c = text[pos];
+            if (in_string) {
+                if (c == '\\') {
+                    ++pos;
+                } else if (c == '"') {
+                    in_string = false;
+                }
+                continue;
+            }
+            if (c == '"') {
+                in_string = true;
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0) {
+                    break;
+                }
+                --depth;
+            } else if (c == ',' && depth == 0) {
+                break;
+            }
+        }
+        size_t end = pos;
+        while (end > start && (text[end - 1] == ' ' || text[end - 1] == '\n' || text[end - 1] == '\r' || text[end - 1] == '\t')) {
+            --end;
+        }
+        out = text.substr(start, end - start);
+        return depth == 0 && !out.empty();
+    }
+
+    std::string_view text;
+    std::pmr::memory_resource* resource;
+    size_t pos = 0;
+};
+
+inline bool looksLikeJson(const StompFrameView& frame) {
+    std::string_view content_type = frame.header("content-type");
+    if (content_type.substr(0, 16) == "application/json") {
+        return true;
+    }
+    size_t first = frame.body.find_first_not_of(" \t\r\n");
+    return first != std::string_view::npos && frame.body[first] == '{';
+}
+
+inline void decodeMessage(const StompFrameView& frame, DecodedMessage& out) {
+    std::pmr::memory_resource* resource = out.headers.get_allocator().resource();
+    out.headers.reserve(frame.headerCount());
+    for (size_t i = 0; i < frame.headerCount(); ++i) {
+        const StompHeader& h = frame.headerAt(i);
+        out.headers.push_back(DecodedHeader{h.name, unescapeHeader(h.value, resource)});
+    }
+    out.body = frame.body;
+    if (looksLikeJson(frame)) {
+        out.is_json = JsonFieldParser(frame.body, resource).parse(out.fields);
+        if (!out.is_json) {
+            out.fields.clear();
+        }
+    }
+}
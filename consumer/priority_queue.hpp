@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "latency.hpp"
+#include "mpsc_queue.hpp"
+#include "spin_wait.hpp"
+#include "stomp_frame.hpp"
+
+// A MESSAGE copied off the receive ring, waiting for the worker.
+struct QueuedMessage {
+    StompMessage message;
+    uint64_t rx_ns = 0;        // kernel receive timestamp, 0 if unavailable
+    uint64_t enqueued_ns = 0;  // monotonicNs() when pushed
+    int priority = 0;
+};
+
+// Hands messages from the I/O thread to a worker, highest STOMP/JMS priority
+// (9) first. Each priority level is its own lock-free MPSC ring, so pushes
+// never contend across levels and a pop is at most one probe per level.
+// Strict priority: a sustained high-priority stream starves lower levels.
+class PriorityMessageQueue {
+public:
+    static constexpr int kLevels = 10;
+    static constexpr int kDefaultPriority = 4;  // JMS default
+
+    explicit PriorityMessageQueue(size_t capacity_per_level, int idle_spins = 2000) : idle_spins(idle_spins) {
+        levels.reserve(kLevels);
+        for (int i = 0; i < kLevels; ++i) {
+            levels.push_back(std::make_unique<MpscQueue<QueuedMessage>>(capacity_per_level));
+        }
+    }
+
+    PriorityMessageQueue(const PriorityMessageQueue&) = delete;
+    PriorityMessageQueue& operator=(const PriorityMessageQueue&) = delete;
+
+    // The `priority` header clamped to 0-9; absent or malformed means default.
+    static int priorityOf(const StompFrameView& frame) {
+        const StompHeader* header = frame.findHeader("priority");
+        int priority = kDefaultPriority;
+        if (header == nullptr ||
+            std::from_chars(header->value.data(), header->value.data() + header->value.size(), priority).ec !=
+                std::errc()) {
+            return kDefaultPriority;
+        }
+        return priority < 0 ? 0 : (priority >= kLevels ? kLevels - 1 : priority);
+    }
+
+    // Copies `frame` into its priority level. Spins while that level is full,
+    // which stops the I/O thread reading and lets TCP push back on the broker.
+    // False once close() has been called: nothing will pop the message.
+    bool push(const StompFrameView& frame, uint64_t rx_ns) {
+        if (closed()) {
+            return false;
+        }
+        QueuedMessage item;
+        item.message.assign(frame);
+        item.rx_ns = rx_ns;
+        item.priority = priorityOf(frame);
+        item.enqueued_ns = monotonicNs();
+        MpscQueue<QueuedMessage>& level = *levels[item.priority];
+        while (!level.tryPush(item)) {
+            if (closed()) {
+                return false;
+            }
+            cpuRelax();
+        }
+        // Pairs with the fence in pop(): either we see the worker asleep or
+        // it sees our message before waiting.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (worker_sleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            wake_cv.notify_one();
+        }
+        return true;
+    }
+
+    // Single consumer. Takes from the highest non-empty level.
+    bool tryPop(QueuedMessage& out) {
+        for (int i = kLevels - 1; i >= 0; --i) {
+            if (levels[i]->tryPop(out)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Spins briefly, then sleeps up to `timeout`. False on timeout or close().
+    bool pop(QueuedMessage& out, std::chrono::milliseconds timeout) {
+        for (int spins = 0; spins < idle_spins; ++spins) {
+            if (tryPop(out)) {
+                return true;
+            }
+            cpuRelax();
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        worker_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sizeApprox() == 0 && !closed()) {
+            wake_cv.wait_for(lock, timeout);
+        }
+        worker_sleeping.store(false, std::memory_order_relaxed);
+        lock.unlock();
+        return tryPop(out);
+    }
+
+    // Wakes a sleeping worker; queued messages can still be popped.
+    void close() {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        is_closed.store(true, std::memory_order_release);
+        wake_cv.notify_all();
+    }
+
+    bool closed() const { return is_closed.load(std::memory_order_acquire); }
+
+    size_t sizeApprox() const {
+        size_t total = 0;
+        for (const auto& level : levels) {
+            total += level->sizeApprox();
+        }
+        return total;
+    }
+
+    size_t sizeApprox(int priority) const { return levels[priority]->sizeApprox(); }
+
+private:
+    std::vector<std::unique_ptr<MpscQueue<QueuedMessage>>> levels;
+    int idle_spins;
+    alignas(kCacheLineSize) std::atomic<bool> worker_sleeping{false};
+    std::atomic<bool> is_closed{false};
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+};
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "expiration.hpp"
+#include "latency.hpp"
+#include "live_config.hpp"
+#include "mpsc_queue.hpp"
+#include "stomp_frame.hpp"
+#include "timer_wheel.hpp"
+
+// Acknowledges messages on the consuming connection (client-individual mode).
+class AckSink {
+public:
+    virtual ~AckSink() = default;
+    // ACK when `accepted`, NACK otherwise; `ack_id` is ackId() of the MESSAGE
+    // and `subscription` its subscription header.
+    virtual bool acknowledge(std::string_view ack_id, std::string_view subscription, bool accepted) = 0;
+};
+
+// Publishes dead letters over its own broker connection from a background
+// thread, so a slow or reconnecting DLQ never stalls message processing.
+// publish() only encodes the frame and pushes it onto a lock-free queue.
+class DeadLetterPublisher {
+public:
+    DeadLetterPublisher(std::string host, int port, size_t queue_capacity = 1024)
+        : host(std::move(host)), port(port), queue(queue_capacity) {}
+
+    ~DeadLetterPublisher() { stop(); }
+
+    DeadLetterPublisher(const DeadLetterPublisher&) = delete;
+    DeadLetterPublisher& operator=(const DeadLetterPublisher&) = delete;
+
+    void start() {
+        running.store(true, std::memory_order_release);
+        sender = std::thread([this] { run(); });
+    }
+
+    // Sends everything already queued (while the connection works), then joins.
+    void stop() {
+        if (!sender.joinable()) {
+            return;
+        }
+        running.store(false, std::memory_order_release);
+        wake_cv.notify_one();
+        sender.join();
+    }
+
+    // Copies the original body and identifying headers into a SEND to
+    // `destination`. Returns false if the queue is full.
+    bool publish(std::string_view destination, const StompFrameView& original, int attempts, std::string_view reason) {
+        StompFrameBuilder builder("SEND", original.body.size() + reason.size() + 256);
+        builder.header("destination", destination)
+            .header("original-destination", original.header("destination"))
+            .header("original-message-id", original.header("message-id"))
+            .header("redelivery-count", static_cast<uint64_t>(attempts))
+            .escapedHeader("dead-letter-reason", reason);
+        for (std::string_view name : {"content-type", "correlation-id", "sent-at-ns"}) {
+            if (const StompHeader* header = original.findHeader(name)) {
+                builder.header(name, header->value);
+            }
+        }
+        builder.header("content-length", original.body.size());
+        PooledBuffer frame = builder.finish(original.body);
+        if (!queue.tryPush(frame)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        wake_cv.notify_one();
+        return true;
+    }
+
+    uint64_t sentCount() const { return sent.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    bool connect() {
+        struct hostent* host_entry = gethostbyname(host.c_str());
+        if (host_entry == nullptr) {
+            return false;
+        }
+        sockaddr_in server_addr{};
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        server_addr.sin_addr = *reinterpret_cast<in_addr*>(host_entry->h_addr_list[0]);
+        sockfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (sockfd < 0) {
+            return false;
+        }
+        PooledBuffer frame = StompFrameBuilder("CONNECT")
+            .header("accept-version", "1.0,1.1,1.2")
+            .header("host", host)
+            .header("heart-beat", "0,0")
+            .finish();
+        char buffer[1024];
+        ssize_t bytes_read = -1;
+        if (::connect(sockfd, reinterpret_cast<sockaddr*>(&server_addr), sizeof(server_addr)) == 0 &&
+            writeAll(frame.data(), frame.size())) {
+            bytes_read = recv(sockfd, buffer, sizeof(buffer), 0);
+        }
+        if (bytes_read <= 0 || std::string_view(buffer, bytes_read).find("CONNECTED") == std::string_view::npos) {
+            close(sockfd);
+            sockfd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    bool writeAll(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::send(sockfd, data, size, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    void run() {
+        PooledBuffer frame;
+        bool have_frame = false;
+        for (;;) {
+            if (!have_frame) {
+                have_frame = queue.tryPop(frame);
+            }
+            if (!have_frame) {
+                if (!running.load(std::memory_order_acquire)) {
+                    break;
+                }
+                std::unique_lock<std::mutex> lock(wake_mutex);
+                wake_cv.wait_for(lock, std::chrono::milliseconds(50));
+                continue;
+            }
+            if (sockfd < 0 && !connect()) {
+                std::cerr << "[CONSUMER] Dead-letter connection failed, retrying" << std::endl;
+                if (!running.load(std::memory_order_acquire)) {
+                    break;  // give up on shutdown rather than retrying forever
+                }
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+                continue;
+            }
+            if (writeAll(frame.data(), frame.size())) {
+                sent.fetch_add(1, std::memory_order_relaxed);
+                have_frame = false;
+            } else {
+                close(sockfd);
+                sockfd = -1;
+            }
+        }
+        if (sockfd >= 0) {
+            PooledBuffer disconnect = StompFrameBuilder("DISCONNECT").finish();
+            writeAll(disconnect.data(), disconnect.size());
+            close(sockfd);
+            sockfd = -1;
+        }
+    }
+
+    std::string host;
+    int port;
+    int sockfd = -1;
+    MpscQueue<PooledBuffer> queue;
+    std::thread sender;
+    std::atomic<bool> running{false};
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+enum class RedeliveryMode {
+    LocalRetry,  // keep a copy and re-run the handler after the delay
+    Nack,        // NACK after the delay and let the broker redeliver
+};
+
+struct RedeliveryOptions {
+    RedeliveryMode mode = RedeliveryMode::LocalRetry;
+    int max_attempts = 3;  // handler runs before a message is dead-lettered
+    std::chrono::milliseconds initial_delay{200};
+    double backoff_multiplier = 2.0;
+    std::chrono::milliseconds max_delay{10000};
+    std::string dead_letter_destination = "/queue/ProjectQueue.DLQ";
+};
+
+struct RedeliveryStats {
+    uint64_t succeeded = 0;
+    uint64_t failures = 0;        // handler exceptions
+    uint64_t retries = 0;         // delayed retries / NACKs issued
+    uint64_t dead_lettered = 0;
+    uint64_t expired = 0;         // retries dropped because the message expired meanwhile
+    uint64_t pending = 0;         // retries waiting in the timer wheel
+};
+
+// Runs message handlers with bounded retries. A handler signals failure by
+// throwing; the message is retried with exponential backoff from a timer
+// wheel and, after max_attempts, handed to the DeadLetterPublisher and
+// ACKed on the main connection. Successful messages are ACKed straight away.
+// Nothing here blocks: waits happen in the wheel, DLQ writes on the side
+// connection's thread. Not thread-safe: process() and poll() run on one
+// thread, the receive loop's or the priority worker's, and poll() from that
+// loop fires due retries.
+class RedeliveryManager {
+public:
+    using Handler = std::function<void(const StompFrameView&)>;
+
+    RedeliveryManager(AckSink& acks, DeadLetterPublisher& dead_letters, const RedeliveryOptions& options)
+        : acks(acks),
+          dead_letters(dead_letters),
+          mode(options.mode),
+          options(options),
+          wheel(10'000'000, 512, monotonicNs()) {}
+
+    // Swaps in new attempt limits, delays and DLQ destination; safe to call
+    // from any thread. The mode is fixed at construction.
+    void updateOptions(RedeliveryOptions next) {
+        next.mode = mode;
+        options.publish(std::move(next));
+    }
+
+    void process(const StompFrameView& frame, const Handler& handler) {
+        int attempt = 1;
+        std::string_view message_id = frame.header("message-id");
+        if (mode == RedeliveryMode::Nack) {
+            // Broker redeliveries keep their message-id, so count them here
+            auto it = nack_attempts.find(std::string(message_id));
+            if (it != nack_attempts.end()) {
+                attempt = it->second + 1;
+            }
+        }
+        run(frame, handler, attempt);
+    }
+
+    // Fires retries that are due; returns how many ran.
+    size_t poll(const Handler& handler) {
+        return wheel.advance(monotonicNs(), [&](PendingRetry& retry) {
+            if (!retry.forget_id.empty()) {
+                // Not redelivered since this NACK (expired or moved to the
+                // broker's DLA): stop counting its attempts
+                auto it = nack_attempts.find(retry.forget_id);
+                if (it != nack_attempts.end() && it->second == retry.attempt) {
+                    nack_attempts.erase(it);
+                }
+                --pending_forgets;
+                return;
+            }
+            if (mode == RedeliveryMode::Nack) {
+                acks.acknowledge(retry.ack_id, retry.subscription, false);
+                return;
+            }
+            if (isExpired(retry.message.view(), realtimeNs() / 1'000'000)) {
+                ++counters.expired;
+                settle(retry.message.view(), true);
+                return;
+            }
+            run(retry.message.view(), handler, retry.attempt + 1);
+        });
+    }
+
+    RedeliveryStats stats() const {
+        RedeliveryStats result = counters;
+        result.pending = wheel.size() - pending_forgets;
+        return result;
+    }
+
+    static std::string_view ackId(const StompFrameView& frame) {
+        const StompHeader* ack = frame.findHeader("ack");
+        return ack != nullptr ? ack->value : frame.header("message-id");  // STOMP 1.0/1.1 ack by message-id
+    }
+
+private:
+    // How long a NACKed message-id's attempt count is kept waiting for the
+    // broker to redeliver it; bounds nack_attempts.
+    static constexpr std::chrono::minutes kNackMemory{5};
+
+    struct PendingRetry {
+        StompMessage message;      // LocalRetry only
+        std::string ack_id;        // Nack only
+        std::string subscription;  // Nack only
+        std::string forget_id;     // set: drop this message-id from nack_attempts instead
+        int attempt = 0;
+    };
+
+    void settle(const StompFrameView& frame, bool accepted) {
+        acks.acknowledge(ackId(frame), frame.header("subscription"), accepted);
+    }
+
+    void run(const StompFrameView& frame, const Handler& handler, int attempt) {
+        const RedeliveryOptions& policy = options.read();
+        std::string reason;
+        try {
+            handler(frame);
+            ++counters.succeeded;
+            if (mode == RedeliveryMode::Nack) {
+                nack_attempts.erase(std::string(frame.header("message-id")));
+            }
+            settle(frame, true);
+            return;
+        } catch (const std::exception& e) {
+            reason = e.what();
+        } catch (...) {
+            reason = "unknown exception";
+        }
+        ++counters.failures;
+
+        if (attempt >= policy.max_attempts) {
+            std::cerr << "[CONSUMER] Message " << frame.header("message-id") << " failed " << attempt
+                      << " times (" << reason << "), moving to " << policy.dead_letter_destination << std::endl;
+            if (dead_letters.publish(policy.dead_letter_destination, frame, attempt, reason)) {
+                ++counters.dead_lettered;
+                if (mode == RedeliveryMode::Nack) {
+                    nack_attempts.erase(std::string(frame.header("message-id")));
+                }
+                settle(frame, true);
+            } else {
+                // DLQ backed up: leave the message to the broker
+                settle(frame, false);
+            }
+            return;
+        }
+
+        double delay_ms = static_cast<double>(policy.initial_delay.count());
+        for (int i = 1; i < attempt; ++i) {
+            delay_ms *= policy.backoff_multiplier;
+        }
+        delay_ms = std::min(delay_ms, static_cast<double>(policy.max_delay.count()));
+
+        PendingRetry retry;
+        retry.attempt = attempt;
+        if (mode == RedeliveryMode::Nack) {
+            retry.ack_id = ackId(frame);
+            retry.subscription = frame.header("subscription");
+            nack_attempts[std::string(frame.header("message-id"))] = attempt;
+
+            PendingRetry forget;
+            forget.forget_id = frame.header("message-id");
+            forget.attempt = attempt;
+            wheel.schedule(static_cast<uint64_t>(delay_ms * 1'000'000.0) +
+                               static_cast<uint64_t>(std::chrono::nanoseconds(kNackMemory).count()),
+                           std::move(forget));
+            ++pending_forgets;
+        } else {
+            retry.message.assign(frame);
+        }
+        wheel.schedule(static_cast<uint64_t>(delay_ms * 1'000'000.0), std::move(retry));
+        ++counters.retries;
+    }
+
+    AckSink& acks;
+    DeadLetterPublisher& dead_letters;
+    const RedeliveryMode mode;
+    RcuSnapshot<RedeliveryOptions> options;
+    TimerWheel<PendingRetry> wheel;
+    std::unordered_map<std::string, int> nack_attempts;
+    size_t pending_forgets = 0;  // kNackMemory entries in the wheel, not retries
+    RedeliveryStats counters;
+};
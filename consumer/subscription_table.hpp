@@ -0,0 +1,70 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "selector.hpp"
+#include "stomp_frame.hpp"
+
+// Routes MESSAGE frames from many subscriptions on one connection to their
+// handlers. The table hands out the SUBSCRIBE ids itself as decimal indices
+// ("0", "1", ...), so dispatching is a from_chars() plus a vector index
+// instead of a string lookup. An entry may carry a compiled selector that
+// is evaluated before its handler, for brokers that do not filter
+// themselves. Not thread-safe: dispatch() runs on the thread that handles
+// messages (the I/O thread, or the worker with priority processing).
+class SubscriptionTable {
+public:
+    using Handler = std::function<void(const StompFrameView&)>;
+
+    struct Entry {
+        std::string destination;
+        std::string id;
+        Handler handler;
+        Selector filter;  // not compiled: every frame passes
+        uint64_t delivered = 0;
+        uint64_t filtered = 0;
+    };
+
+    // Returns the id to put in the SUBSCRIBE frame.
+    const std::string& add(std::string destination, Handler handler, Selector filter = Selector()) {
+        Entry entry;
+        entry.destination = std::move(destination);
+        entry.id = std::to_string(entries.size());
+        entry.handler = std::move(handler);
+        entry.filter = std::move(filter);
+        entries.push_back(std::move(entry));
+        return entries.back().id;
+    }
+
+    size_t size() const { return entries.size(); }
+    const Entry& at(size_t index) const { return entries[index]; }
+    uint64_t unrouted() const { return unrouted_frames; }
+
+    // Returns false (and counts the frame) if no handler owns its subscription.
+    bool dispatch(const StompFrameView& frame) {
+        std::string_view id = frame.header("subscription");
+        size_t index = 0;
+        auto result = std::from_chars(id.data(), id.data() + id.size(), index);
+        if (result.ec != std::errc() || result.ptr != id.data() + id.size() || index >= entries.size()) {
+            ++unrouted_frames;
+            return false;
+        }
+        Entry& entry = entries[index];
+        if (!entry.filter.matches(frame)) {
+            ++entry.filtered;
+            return true;
+        }
+        ++entry.delivered;
+        entry.handler(frame);
+        return true;
+    }
+
+private:
+    std::vector<Entry> entries;
+    uint64_t unrouted_frames = 0;
+};
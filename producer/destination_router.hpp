@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "latency.hpp"
+#include "stomp_frame.hpp"
+
+// One send target. The static part of every SEND header block is rendered
+// once here so encoding a message only appends the per-message headers.
+struct DestinationRoute {
+    std::string name;
+    std::string header_block;  // "destination:...\ncontent-type:...\n"
+};
+
+// Maps each outgoing message to one of several queues/topics. Routes are
+// registered up front and addressed by index, which doubles as the
+// publisher lane the frame is batched on.
+class DestinationRouter {
+public:
+    // Picks a route index for the message with sequence number `sequence`.
+    // Out-of-range results wrap around.
+    using RouteFunction = std::function<size_t(uint64_t sequence, std::string_view body)>;
+
+    size_t add(std::string_view destination, std::string_view content_type = "text/plain") {
+        DestinationRoute route;
+        route.name = destination;
+        route.header_block.reserve(destination.size() + content_type.size() + 30);
+        route.header_block.append("destination:").append(destination).append("\n");
+        route.header_block.append("content-type:").append(content_type).append("\n");
+        routes.push_back(std::move(route));
+        return routes.size() - 1;
+    }
+
+    // Default is round-robin by sequence number.
+    void setRouteFunction(RouteFunction function) { route_function = std::move(function); }
+
+    size_t size() const { return routes.size(); }
+    bool empty() const { return routes.empty(); }
+    const DestinationRoute& at(size_t index) const { return routes[index]; }
+
+    size_t route(uint64_t sequence, std::string_view body) const {
+        size_t index = route_function ? route_function(sequence, body) : static_cast<size_t>(sequence);
+        return index < routes.size() ? index : index % routes.size();
+    }
+
+    // `expires_ms` is the absolute expiry (ms since the epoch), 0 for none.
+    // `intended_at_ns` is the scheduled send time in open-loop load tests.
+    // `traceparent` is set only on messages sampled for tracing.
+    PooledBuffer encodeSend(size_t index, std::string_view body, uint64_t sent_at_ns, uint64_t expires_ms = 0,
+                            uint64_t intended_at_ns = 0, std::string_view traceparent = {}) const {
+        const DestinationRoute& target = routes[index];
+        StompFrameBuilder builder("SEND", target.header_block.size() + body.size() + 96);
+        builder.headers(target.header_block)
+            .header("content-length", body.size())
+            .header("sent-at-ns", sent_at_ns);
+        if (expires_ms != 0) {
+            builder.header("expires", expires_ms);
+        }
+        if (intended_at_ns != 0) {
+            builder.header("intended-at-ns", intended_at_ns);
+        }
+        if (!traceparent.empty()) {
+            builder.header("traceparent", traceparent);
+        }
+        return builder.finish(body);
+    }
+
+private:
+    std::vector<DestinationRoute> routes;
+    RouteFunction route_function;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "latency.hpp"
+
+// Open-loop load: message `sequence` (1-based) is due at
+// start + (sequence - 1) / rate no matter how long earlier sends took, so a
+// stalled broker cannot slow the schedule down and hide its own queueing.
+// Times are CLOCK_REALTIME nanoseconds, like the sent-at-ns header.
+class SendSchedule {
+public:
+    SendSchedule(double messages_per_second, uint64_t start_ns)
+        : interval_ns(messages_per_second > 0 ? 1e9 / messages_per_second : 0), start_ns(start_ns) {}
+
+    bool enabled() const { return interval_ns > 0; }
+
+    uint64_t intendedNs(uint64_t sequence) const {
+        return start_ns + static_cast<uint64_t>(static_cast<double>(sequence - 1) * interval_ns);
+    }
+
+    // Sleeps until `sequence` is due and returns its intended send time. A
+    // message that is already late is sent at once; none are skipped.
+    uint64_t waitFor(uint64_t sequence) const {
+        uint64_t due = intendedNs(sequence);
+        uint64_t now = realtimeNs();
+        if (now < due) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+        }
+        return due;
+    }
+
+private:
+    double interval_ns;
+    uint64_t start_ns;
+};
+
+// Send latency measured two ways. Uncorrected starts the clock when the
+// send actually began, which is what a closed-loop client sees and hides
+// the time a message waited behind a slow predecessor. Corrected starts it
+// at the scheduled time, i.e. what an independent client arriving on
+// schedule would have experienced. One per thread; merge() to report.
+struct SendLatency {
+    LatencyHistogram uncorrected;
+    LatencyHistogram corrected;
+
+    void record(uint64_t intended_ns, uint64_t started_ns, uint64_t finished_ns) {
+        if (finished_ns >= started_ns) {
+            uncorrected.record(finished_ns - started_ns);
+        }
+        if (finished_ns >= intended_ns) {
+            corrected.record(finished_ns - intended_ns);
+        }
+    }
+
+    void merge(const SendLatency& other) {
+        uncorrected.merge(other.uncorrected);
+        corrected.merge(other.corrected);
+    }
+
+    void print(std::ostream& out, const char* prefix) const {
+        uncorrected.print(out, prefix, "send (uncorrected)");
+        corrected.print(out, prefix, "send (from intended time)");
+    }
+};
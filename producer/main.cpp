@@ -1,5 +1,6 @@
 #include <iostream>
 #include <string>
+#include <vector>
 #include <chrono>
 #include <thread>
 #include <sys/socket.h>
@@ -10,13 +11,47 @@
 #include <cstring>
 #include <sstream>
 #include <iomanip>
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+#include <sys/uio.h>
 
-class SimpleStompClient {
+#include "admin_server.hpp"
+#include "async_stomp.hpp"
+#include "buffer_pool.hpp"
+#include "config.hpp"
+#include "cpu_affinity.hpp"
+#include "destination_router.hpp"
+#include "expiration.hpp"
+#include "frame_capture.hpp"
+#include "latency.hpp"
+#include "live_config.hpp"
+#include "load_schedule.hpp"
+#include "log_level.hpp"
+#include "payload_generator.hpp"
+#include "publisher.hpp"
+#include "sampling_profiler.hpp"
+#include "span_exporter.hpp"
+#include "replay.hpp"
+#include "stomp_frame.hpp"
+#include "trace.hpp"
+#include "trace_context.hpp"
+
+// Broker connection settings shared by the threaded and coroutine paths.
+struct BrokerSettings {
+    std::string host = "activemq";  // Docker service name
+    int port = 61613;               // STOMP port
+    int max_retries = 10;
+    std::chrono::milliseconds retry_interval{3000};
+};
+
+class SimpleStompClient : public FrameSink {
 private:
     int sockfd;
     std::string host;
     int port;
     bool connected;
+    FrameCapture* capture = nullptr;
 
 public:
     SimpleStompClient(const std::string& h, int p) : host(h), port(p), connected(false), sockfd(-1) {}
@@ -25,6 +60,9 @@ public:
         disconnect();
     }
 
+    // Records every frame written and read; set before connect().
+    void setCapture(FrameCapture* frame_capture) { capture = frame_capture; }
+
     bool connect() {
         // Create socket
         sockfd = socket(AF_INET, SOCK_STREAM, 0);
@@ -56,14 +94,16 @@ public:
         }
 
         // Send STOMP CONNECT frame
-        std::string connectFrame = "CONNECT\n";
-        connectFrame += "accept-version:1.0,1.1,1.2\n";
-        connectFrame += "host:" + host + "\n";
-        connectFrame += "heart-beat:0,0\n";
-        connectFrame += "\n";
-        connectFrame += char(0); // null terminator
-
-        if (send(sockfd, connectFrame.c_str(), connectFrame.length(), 0) < 0) {
+        PooledBuffer connectFrame = StompFrameBuilder("CONNECT")
+            .header("accept-version", "1.0,1.1,1.2")
+            .header("host", host)
+            .header("heart-beat", "0,0")
+            .finish();
+        if (capture != nullptr) {
+            capture->record(CaptureDirection::Sent, connectFrame);
+        }
+
+        if (send(sockfd, connectFrame.data(), connectFrame.size(), 0) < 0) {
             std::cerr << "Error sending CONNECT frame" << std::endl;
             close(sockfd);
             return false;
@@ -73,6 +113,9 @@ public:
         char buffer[1024];
         int bytes_read = recv(sockfd, buffer, sizeof(buffer), 0);
         if (bytes_read > 0) {
+            if (capture != nullptr) {
+                capture->record(CaptureDirection::Received, buffer, static_cast<size_t>(bytes_read));
+            }
             buffer[bytes_read] = '\0';
             std::string response(buffer);
             if (response.find("CONNECTED") != std::string::npos) {
@@ -87,32 +130,51 @@ public:
         return false;
     }
 
-    bool sendMessage(const std::string& destination, const std::string& message) {
+    // Not thread-safe by itself: the Publisher's sender thread is the only
+    // caller while it is running.
+    bool writeFrames(const iovec* frames, int count) override {
         if (!connected) {
-            std::cerr << "Not connected to broker" << std::endl;
             return false;
         }
-
-        std::string sendFrame = "SEND\n";
-        sendFrame += "destination:" + destination + "\n";
-        sendFrame += "content-type:text/plain\n";
-        sendFrame += "content-length:" + std::to_string(message.length()) + "\n";
-        sendFrame += "\n" + message;
-        sendFrame += char(0); // null terminator
-
-        if (send(sockfd, sendFrame.c_str(), sendFrame.length(), 0) < 0) {
-            std::cerr << "Error sending message" << std::endl;
-            return false;
+        iovec pending[IOV_MAX];
+        int remaining = std::min(count, IOV_MAX);
+        if (capture != nullptr) {
+            capture->record(CaptureDirection::Sent, frames, remaining);
+        }
+        std::copy(frames, frames + remaining, pending);
+        iovec* cursor = pending;
+        TRACE_SCOPE_ARG("syscall", remaining);
+        while (remaining > 0) {
+            ssize_t written = writev(sockfd, cursor, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cerr << "Error writing frames: " << strerror(errno) << std::endl;
+                return false;
+            }
+            // Skip fully written frames and trim a partially written one
+            size_t left = static_cast<size_t>(written);
+            while (remaining > 0 && left >= cursor->iov_len) {
+                left -= cursor->iov_len;
+                ++cursor;
+                --remaining;
+            }
+            if (remaining > 0) {
+                cursor->iov_base = static_cast<char*>(cursor->iov_base) + left;
+                cursor->iov_len -= left;
+            }
         }
-
         return true;
     }
 
     void disconnect() {
         if (connected && sockfd >= 0) {
-            std::string disconnectFrame = "DISCONNECT\n\n";
-            disconnectFrame += char(0); // null terminator
-            send(sockfd, disconnectFrame.c_str(), disconnectFrame.length(), 0);
+            PooledBuffer disconnectFrame = StompFrameBuilder("DISCONNECT").finish();
+            if (capture != nullptr) {
+                capture->record(CaptureDirection::Sent, disconnectFrame);
+            }
+            send(sockfd, disconnectFrame.data(), disconnectFrame.size(), 0);
             close(sockfd);
             connected = false;
             std::cout << "[PRODUCER] Disconnected from ActiveMQ" << std::endl;
@@ -123,71 +185,614 @@ public:
 std::string generateMessageId(int index) {
     auto now = std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
+    std::tm local_time;
+    localtime_r(&time_t, &local_time);  // may be called from several publisher threads
     
     std::stringstream ss;
-    ss << "MSG_" << std::put_time(std::localtime(&time_t), "%Y%m%d_%H%M%S") 
+    ss << "MSG_" << std::put_time(&local_time, "%Y%m%d_%H%M%S") 
        << "_INDEX_" << index;
     return ss.str();
 }
 
-int main() {
+// Body of message `index`: from the pre-generated pool, or the classic
+// greeting built into `greeting` when no generator is configured.
+std::string_view payloadFor(const PayloadGenerator& payloads, int index, std::string& greeting) {
+    if (payloads.enabled()) {
+        return payloads.payload(static_cast<uint64_t>(index - 1));
+    }
+    greeting = "Hello from C++ Producer - " + generateMessageId(index);
+    return greeting;
+}
+
+// Generated payloads can be large and unprintable in bulk; log their size.
+std::string describePayload(const PayloadGenerator& payloads, std::string_view body) {
+    return payloads.enabled() ? std::to_string(body.size()) + " byte payload" : std::string(body);
+}
+
+// Head-based sampling for one message. A sampled message starts a new trace
+// whose root is this PRODUCER span; returns its traceparent, or an empty
+// view (and leaves `span` alone) when the message is not sampled.
+std::string_view startSendSpan(double ratio, SpanRecord& span, char (&header)[TraceContext::kHeaderLength]) {
+    if (!sampleTrace(ratio)) {
+        return {};
+    }
+    span.kind = SpanRecord::kProducer;
+    span.context = TraceIdGenerator::child(nullptr, true);
+    span.start_ns = realtimeNs();
+    return formatTraceparent(span.context, header);
+}
+
+void finishSendSpan(SpanExporter& exporter, SpanRecord& span, std::string_view destination, size_t body_bytes,
+                    bool ok) {
+    if (!exporter.active()) {
+        return;
+    }
+    span.end_ns = realtimeNs();
+    span.destination = destination;
+    span.name = "send " + span.destination;
+    span.body_bytes = body_bytes;
+    span.error = !ok;
+    exporter.submit(span);
+}
+
+// Settings that SIGHUP or POST /reload can change while the producer runs.
+struct LiveSettings {
+    std::chrono::milliseconds send_interval{1000};
+    size_t max_batch_frames = 64;
+    size_t max_batch_bytes = 256 * 1024;
+    LogLevel log_level = LogLevel::Info;
+    double trace_sample_ratio = 0;
+};
+
+// Used at startup and on every reload.
+LiveSettings readLiveSettings(Config& config) {
+    LiveSettings settings;
+    config.beginReloadable();
+    settings.send_interval = config.getMillis("send-interval", settings.send_interval,
+                                              "pause between messages per publishing thread");
+    settings.max_batch_frames =
+        config.getSize("max-batch-frames", settings.max_batch_frames, "frames per writev()", 1);
+    settings.max_batch_bytes = config.getSize("max-batch-bytes", settings.max_batch_bytes, "bytes per writev()", 1);
+    if (!parseLogLevel(config.getString("log-level", logLevelName(settings.log_level), "debug, info, warn or error"),
+                       settings.log_level)) {
+        config.reject("log-level", "debug, info, warn or error");
+    }
+    settings.trace_sample_ratio = config.getDouble("trace-sample-ratio", settings.trace_sample_ratio,
+                                                   "share of messages given a W3C traceparent, 0 to 1");
+    if (settings.trace_sample_ratio < 0 || settings.trace_sample_ratio > 1) {
+        config.reject("trace-sample-ratio", "a number from 0 to 1");
+    }
+    config.endReloadable();
+    return settings;
+}
+
+// Same flow as main() on the coroutine client: one thread, no publisher
+// queue, every step a co_await on the event loop.
+Task<void> runAsyncProducer(EventLoop& loop, const BrokerSettings& broker, const DestinationRouter& router,
+                            std::chrono::milliseconds ttl, int message_count, const RcuSnapshot<LiveSettings>& live,
+                            const PayloadGenerator& payloads, double target_rate, SendLatency& latency,
+                            SpanExporter& spans, FrameCapture* capture, int& exit_code) {
+    AsyncStompClient client(loop, broker.host, broker.port);
+    client.setCapture(capture);
+    bool connected = false;
+    for (int retry = 1; retry <= broker.max_retries && !connected; ++retry) {
+        std::cout << "[PRODUCER] Connection attempt " << retry << "/" << broker.max_retries << std::endl;
+        connected = co_await client.connect();
+        if (!connected && retry < broker.max_retries) {
+            std::cout << "[PRODUCER] Retrying in " << broker.retry_interval.count() << " ms..." << std::endl;
+            co_await loop.sleepFor(broker.retry_interval);
+        }
+    }
+    if (!connected) {
+        std::cerr << "[PRODUCER] Failed to connect to ActiveMQ after " << broker.max_retries << " attempts" << std::endl;
+        co_return;
+    }
+    std::cout << "[PRODUCER] Connected to ActiveMQ (async client)" << std::endl;
+
+    int sent = 0;
+    std::string greeting;
+    SendSchedule schedule(target_rate, realtimeNs());
+    for (int i = 1; i <= message_count; ++i) {
+        std::string_view body = payloadFor(payloads, i, greeting);
+        uint64_t intended_ns = 0;
+        if (schedule.enabled()) {
+            intended_ns = schedule.intendedNs(i);
+            uint64_t now = realtimeNs();
+            if (now < intended_ns) {
+                co_await loop.sleepFor(std::chrono::nanoseconds(intended_ns - now));
+            }
+        }
+        const LiveSettings& settings = live.read();
+        if (settings.log_level <= LogLevel::Info) {
+            std::cout << "[PRODUCER] Sending message " << i << "/" << message_count << ": "
+                      << describePayload(payloads, body) << std::endl;
+        }
+        size_t route = router.route(i, body);
+        SpanRecord span;
+        char traceparent_buffer[TraceContext::kHeaderLength];
+        std::string_view traceparent = startSendSpan(settings.trace_sample_ratio, span, traceparent_buffer);
+        uint64_t now_ns = realtimeNs();
+        PooledBuffer frame;
+        {
+            TRACE_SCOPE_ARG("encode", body.size());
+            frame = router.encodeSend(route, body, now_ns, expiresAt(now_ns, ttl), intended_ns, traceparent);
+        }
+        bool ok = co_await client.sendFrame(std::move(frame));
+        if (ok) {
+            ++sent;
+        } else {
+            std::cerr << "[PRODUCER] Failed to send message " << i << std::endl;
+        }
+        if (!traceparent.empty()) {
+            finishSendSpan(spans, span, router.at(route).name, body.size(), ok);
+        }
+        if (schedule.enabled()) {
+            latency.record(intended_ns, now_ns, realtimeNs());
+        } else if (i < message_count && settings.send_interval.count() > 0) {
+            co_await loop.sleepFor(settings.send_interval);
+        }
+    }
+
+    std::cout << "[PRODUCER] Sent " << sent << "/" << message_count << " messages. Disconnecting..." << std::endl;
+    co_await client.disconnect();
+    exit_code = sent == message_count ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
     std::cout << "[PRODUCER] Starting C++ Producer Application" << std::endl;
-    
+
+    // Every knob below can be set with --key=value, PRODUCER_<KEY> or a
+    // config file (--config / PRODUCER_CONFIG); see --help.
+    Config config("PRODUCER");
+    std::string config_error;
+    if (!config.load(argc, argv, config_error)) {
+        std::cerr << "[PRODUCER] " << config_error << std::endl;
+        return 1;
+    }
+
     // Connection parameters
-    std::string broker_host = "activemq";  // Docker service name
-    int broker_port = 61613;  // STOMP port
-    std::string queue_destination = "/queue/ProjectQueue";
+    BrokerSettings broker;
+    broker.host = config.getString("broker-host", broker.host, "STOMP broker host name");
+    broker.port = static_cast<int>(config.getInt("broker-port", broker.port, "STOMP broker port", 1, 65535));
+    broker.max_retries = static_cast<int>(
+        config.getInt("connect-retries", broker.max_retries, "connection attempts before giving up", 1, 1'000'000));
+    broker.retry_interval = config.getMillis("retry-interval", broker.retry_interval, "wait between connection attempts");
+    // Messages are spread over these destinations by the route function
+    // (round-robin by default); each one gets its own publisher lane.
+    std::vector<std::string> destinations =
+        config.getList("destinations", "/queue/ProjectQueue", "comma-separated send destinations");
+    if (destinations.empty()) {
+        config.reject("destinations", "at least one destination");
+    }
+    // Message bodies: the greeting, or a pre-generated pool of random text
+    // or JSON with a configurable size distribution
+    PayloadOptions payload_options;
+    if (!parsePayloadContent(config.getString("payload", payloadContentName(payload_options.content),
+                                              "message bodies: greeting, random or json"),
+                             payload_options.content)) {
+        config.reject("payload", "greeting, random or json");
+    }
+    if (!parseSizeDistribution(config.getString("payload-distribution",
+                                                sizeDistributionName(payload_options.distribution),
+                                                "body sizes: fixed, uniform, lognormal or empirical"),
+                               payload_options.distribution)) {
+        config.reject("payload-distribution", "fixed, uniform, lognormal or empirical");
+    }
+    payload_options.size = config.getSize("payload-size", payload_options.size, "fixed body size, lognormal median");
+    payload_options.min_size = config.getSize("payload-min-size", payload_options.min_size, "smallest body size");
+    payload_options.max_size = config.getSize("payload-max-size", payload_options.max_size, "largest body size");
+    payload_options.sigma = config.getDouble("payload-sigma", payload_options.sigma, "lognormal shape parameter");
+    payload_options.size_file =
+        config.getString("payload-size-file", "", "empirical sizes, one 'size [weight]' per line");
+    if (payload_options.distribution == SizeDistribution::Empirical && payload_options.size_file.empty()) {
+        config.reject("payload-size-file", "a file for the empirical distribution");
+    }
+    payload_options.compressibility = config.getDouble(
+        "payload-compressibility", payload_options.compressibility, "repeated share of body text, 0 to 1");
+    if (payload_options.compressibility < 0 || payload_options.compressibility > 1) {
+        config.reject("payload-compressibility", "a number from 0 to 1");
+    }
+    payload_options.seed = static_cast<uint64_t>(
+        config.getInt("payload-seed", static_cast<int64_t>(payload_options.seed), "payload generator seed", 0,
+                      INT64_MAX));
+    payload_options.pool_size =
+        config.getSize("payload-pool", payload_options.pool_size, "distinct payloads to pre-generate");
+
+    DestinationRouter router;
+    for (const std::string& destination : destinations) {
+        router.add(destination, payloadContentType(payload_options.content));
+    }
+    // Sets the `expires` header so consumers skip messages that went stale
+    // in a backlog; zero sends messages that never expire.
+    const std::chrono::milliseconds message_ttl =
+        config.getMillis("message-ttl", std::chrono::milliseconds(60000), "message time-to-live, 0 for none");
+    const int message_count =
+        static_cast<int>(config.getInt("message-count", 10, "messages to send", 0, 1'000'000'000));
+    // Pacing, batch limits and log level can be changed without a restart
+    RcuSnapshot<LiveSettings> live(readLiveSettings(config));
+    HugePageMode huge_pages = HugePageMode::Off;
+    if (!parseHugePageMode(config.getString("huge-pages", "off", "buffer pool huge pages: off, transparent or explicit"),
+                           huge_pages)) {
+        config.reject("huge-pages", "off, transparent or explicit");
+    }
+
+    // Thread-per-core mode: pin the main, application and sender threads
+    // to these CPUs, e.g. "2-3". Empty leaves scheduling to the kernel.
+    std::string cpu_list = config.getString("cpus", "", "CPU list to pin threads to, e.g. 2-3");
+    bool numa_local_buffers = config.getBool("numa-local-buffers", false, "bind thread memory to the local NUMA node");
+    std::vector<int> cpus;
+    if (!parseCpuList(cpu_list, cpus)) {
+        config.reject("cpus", "a CPU list like 0-3,8");
+    }
+
+    // Run the coroutine-based client instead of the threaded publisher
+    const bool use_async_client =
+        config.getBool("async-client", false, "use the coroutine client instead of the threaded publisher");
+
+    // Application threads share the connection through the publisher; its
+    // sender thread is the only one that touches the socket.
+    const int publisher_threads = static_cast<int>(
+        config.getInt("publisher-threads", 1, "application threads publishing messages", 1, 1024));
+    PublisherOptions publisher_options;
+    publisher_options.queue_capacity =
+        config.getSize("queue-capacity", publisher_options.queue_capacity, "frames per publisher lane queue");
+    publisher_options.max_inflight_messages =
+        config.getSize("max-inflight-messages", 1024, "backpressure limit in messages");
+    publisher_options.max_inflight_bytes =
+        config.getSize("max-inflight-bytes", 4 * 1024 * 1024, "backpressure limit in bytes");
+    publisher_options.max_batch_frames = live.read().max_batch_frames;
+    publisher_options.max_batch_bytes = live.read().max_batch_bytes;
+    publisher_options.idle_spins = static_cast<int>(config.getInt(
+        "idle-spins", publisher_options.idle_spins, "sender polls before sleeping", 0, 1'000'000'000));
+    publisher_options.lanes = router.size();
+    const std::chrono::milliseconds send_timeout = config.getMillis(
+        "send-timeout", std::chrono::milliseconds(5000), "how long send() waits under backpressure");
+    // Open-loop load: send on a fixed schedule of this many messages per
+    // second across all threads, and measure latency from each message's
+    // scheduled time as well as from when it was actually sent. Zero keeps
+    // the closed-loop send-interval pacing.
+    const double target_rate =
+        config.getDouble("target-rate", 0, "open-loop messages per second, 0 for send-interval pacing");
+    if (target_rate < 0) {
+        config.reject("target-rate", "a non-negative number");
+    }
+    // Operator endpoint (POST /reload, GET /config); 0 disables it
+    const int admin_port = static_cast<int>(config.getInt("admin-port", 0, "admin HTTP port, 0 to disable", 0, 65535));
+    const std::string admin_address = config.getString("admin-address", "127.0.0.1", "admin HTTP bind address");
+    // CPU profiling on demand through the admin port (POST /profile/start)
+    const bool profiler = config.getBool("profiler", false, "allow sampling profiles via the admin port");
+    const size_t profile_buffer = config.getSize("profile-buffer", 32768, "stacks kept per profile run");
+    // Records every frame on the broker connection, with timestamps, for
+    // offline replay. Empty disables capture.
+    const std::string capture_file = config.getString("capture-file", "", "record all frames to this file");
+    const size_t capture_chunk_size =
+        config.getSize("capture-chunk-size", 64 * 1024 * 1024, "capture file growth step");
+    // Per-stage trace points, exported as Chrome trace / Perfetto JSON on exit
+    const std::string trace_file = config.getString("trace-file", "", "write a Chrome trace of hot-path stages here");
+    const size_t trace_buffer =
+        config.getSize("trace-buffer", 65536, "trace events kept per thread (most recent win)");
+    if (!trace_file.empty() && !STOMP_TRACE) {
+        config.reject("trace-file", "a build with STOMP_TRACING=ON");
+    }
+    // Spans of sampled sends (see trace-sample-ratio) as OTLP JSON lines
+    const std::string span_file = config.getString("span-file", "", "export OpenTelemetry spans to this file");
+    // Replay mode: re-send the messages of a producer or consumer capture
+    // instead of generating them; message-count and send-interval are unused.
+    const std::string replay_file = config.getString("replay-file", "", "re-send the messages in this capture file");
+    const double replay_speed =
+        config.getDouble("replay-speed", 1.0, "replay pace: 1 as captured, 2 twice as fast, 0 as fast as possible");
+    if (replay_speed < 0) {
+        config.reject("replay-speed", "a non-negative number");
+    }
+    if (!replay_file.empty() && use_async_client) {
+        config.reject("replay-file", "the threaded publisher (async-client=false)");
+    }
+
+    if (config.helpRequested()) {
+        config.printHelp(std::cout);
+        return 0;
+    }
+    if (!config.validate(config_error)) {
+        std::cerr << "[PRODUCER] Invalid configuration: " << config_error << std::endl;
+        return 1;
+    }
+    config.print(std::cout, "[PRODUCER]");
+
+    // Generated before connecting so it never shows up in send timings
+    PayloadGenerator payloads;
+    if (!payloads.init(payload_options, config_error)) {
+        std::cerr << "[PRODUCER] " << config_error << std::endl;
+        return 1;
+    }
+    if (payloads.enabled()) {
+        std::cout << "[PRODUCER] Generated " << payloads.poolSize() << " " << payloadContentName(payload_options.content)
+                  << " payloads (" << payloads.poolBytes() << " bytes, " << payloads.minSize() << "-"
+                  << payloads.maxSize() << " bytes each)" << std::endl;
+    }
+
+    // SIGHUP and POST /reload re-read the config file and publish a new
+    // LiveSettings snapshot; other changed keys are reported, not applied.
+    std::mutex reload_mutex;  // Config is not thread-safe
+    std::atomic<Publisher*> active_publisher{nullptr};
+    auto reload = [&]() -> std::string {
+        std::lock_guard<std::mutex> lock(reload_mutex);
+        std::string error;
+        std::vector<std::string> restart_required;
+        if (!config.reload(error, restart_required)) {
+            return "reload failed: " + error;
+        }
+        LiveSettings next = readLiveSettings(config);
+        if (!config.validate(error)) {
+            config.rollback();
+            return "reload rejected: " + error;
+        }
+        if (Publisher* publisher = active_publisher.load(std::memory_order_acquire)) {
+            publisher->setBatchLimits(next.max_batch_frames, next.max_batch_bytes);
+        }
+        live.publish(next);
+        std::string result = "reloaded (version " + std::to_string(live.version()) + ")";
+        for (const std::string& key : restart_required) {
+            result += "; " + key + " needs a restart";
+        }
+        return result;
+    };
+    ReloadSignal reload_signal([&] { std::cout << "[PRODUCER] SIGHUP: " << reload() << std::endl; });
+    reload_signal.start();
+    AdminServer admin;
+    admin.route("POST", "/reload",
+                [&](const AdminRequest&) { return AdminResponse{200, "text/plain", reload() + "\n"}; });
+    admin.route("GET", "/config", [&](const AdminRequest&) {
+        std::lock_guard<std::mutex> lock(reload_mutex);
+        std::ostringstream out;
+        config.print(out, "");
+        return AdminResponse{200, "text/plain", out.str()};
+    });
+    if (profiler) {
+        addProfileRoutes(admin, profile_buffer);
+    }
+    if (admin_port != 0 && !admin.start(admin_address, admin_port)) {
+        std::cerr << "[PRODUCER] Cannot listen on admin port " << admin_address << ":" << admin_port << std::endl;
+        return 1;
+    }
+
+    CaptureReader replay;
+    if (!replay_file.empty()) {
+        std::string error;
+        if (!replay.open(replay_file, error)) {
+            std::cerr << "[PRODUCER] " << error << std::endl;
+            return 1;
+        }
+    }
+    FrameCapture capture;
+    if (!capture_file.empty()) {
+        std::string error;
+        if (!capture.open(capture_file, capture_chunk_size, error)) {
+            std::cerr << "[PRODUCER] " << error << std::endl;
+            return 1;
+        }
+        std::cout << "[PRODUCER] Capturing frames to " << capture_file << std::endl;
+    }
+    if (!trace_file.empty()) {
+        Tracer::instance().enable(trace_buffer);
+    }
+    SpanExporter spans("producer");
+    if (!span_file.empty() && !spans.start(span_file, config_error)) {
+        std::cerr << "[PRODUCER] " << config_error << std::endl;
+        return 1;
+    }
+    auto finish_spans = [&] {
+        if (!span_file.empty()) {
+            spans.stop();
+            std::cout << "[PRODUCER] Exported " << spans.exportedCount() << " spans to " << span_file << " ("
+                      << spans.droppedCount() << " dropped)" << std::endl;
+        }
+    };
+    auto finish_trace = [&] {
+        if (trace_file.empty()) {
+            return;
+        }
+        std::string error;
+        if (Tracer::instance().writeChromeTrace(trace_file, error)) {
+            std::cout << "[PRODUCER] Wrote trace of " << Tracer::instance().threadCount() << " thread(s) to " << trace_file
+                      << " (" << Tracer::instance().droppedEvents() << " events overwritten)" << std::endl;
+        } else {
+            std::cerr << "[PRODUCER] " << error << std::endl;
+        }
+    };
+    auto finish_capture = [&] {
+        if (capture.isOpen()) {
+            capture.close();
+            std::cout << "[PRODUCER] Captured " << capture.recordCount() << " frames (" << capture.bytesWritten()
+                      << " bytes, " << capture.droppedCount() << " dropped) to " << capture_file << std::endl;
+        }
+    };
+
+    BufferPool::instance().setHugePageMode(huge_pages);
+    CoreRuntime runtime(cpus, numa_local_buffers);
+    CoreStats& main_stats = runtime.attachCurrentThread("main");
+
+    if (use_async_client) {
+        EventLoop loop;
+        int exit_code = 1;
+        SendLatency latency;
+        loop.spawn(runAsyncProducer(loop, broker, router, message_ttl, message_count, live, payloads, target_rate,
+                                    latency, spans, capture.isOpen() ? &capture : nullptr, exit_code));
+        loop.run();
+        finish_spans();
+        finish_capture();
+        finish_trace();
+        if (latency.corrected.count() > 0) {
+            latency.print(std::cout, "[PRODUCER]");
+        }
+        if (exit_code == 0) {
+            std::cout << "[PRODUCER] Producer application completed successfully" << std::endl;
+        }
+        return exit_code;
+    }
     
     // Retry connection logic to handle broker startup delays
-    SimpleStompClient client(broker_host, broker_port);
+    SimpleStompClient client(broker.host, broker.port);
+    client.setCapture(capture.isOpen() ? &capture : nullptr);
     bool connection_successful = false;
-    int max_retries = 10;
-    
-    for (int retry = 1; retry <= max_retries; ++retry) {
-        std::cout << "[PRODUCER] Connection attempt " << retry << "/" << max_retries << std::endl;
+
+    for (int retry = 1; retry <= broker.max_retries; ++retry) {
+        std::cout << "[PRODUCER] Connection attempt " << retry << "/" << broker.max_retries << std::endl;
         
         if (client.connect()) {
             connection_successful = true;
             break;
         }
         
-        if (retry < max_retries) {
-            std::cout << "[PRODUCER] Retrying in 3 seconds..." << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(3));
+        if (retry < broker.max_retries) {
+            std::cout << "[PRODUCER] Retrying in " << broker.retry_interval.count() << " ms..." << std::endl;
+            std::this_thread::sleep_for(broker.retry_interval);
         }
     }
     
     if (!connection_successful) {
-        std::cerr << "[PRODUCER] Failed to connect to ActiveMQ after " << max_retries << " attempts" << std::endl;
+        std::cerr << "[PRODUCER] Failed to connect to ActiveMQ after " << broker.max_retries << " attempts" << std::endl;
         return 1;
     }
     
-    // Send 10 messages
-    const int message_count = 10;
-    std::cout << "[PRODUCER] Sending " << message_count << " messages to " << queue_destination << std::endl;
-    
-    for (int i = 1; i <= message_count; ++i) {
-        std::string message_id = generateMessageId(i);
-        std::string full_message = "Hello from C++ Producer - " + message_id;
-        
-        std::cout << "[PRODUCER] Sending message " << i << "/" << message_count 
-                  << ": " << full_message << std::endl;
-        
-        if (client.sendMessage(queue_destination, full_message)) {
-            std::cout << "[PRODUCER] Message " << i << " sent successfully" << std::endl;
+    Publisher publisher(client, publisher_options);
+    publisher.start(runtime);
+    active_publisher.store(&publisher, std::memory_order_release);
+
+    if (!replay_file.empty()) {
+        std::cout << "[PRODUCER] Replaying " << replay_file;
+        if (replay_speed > 0) {
+            std::cout << " at " << replay_speed << "x the captured pace" << std::endl;
         } else {
-            std::cerr << "[PRODUCER] Failed to send message " << i << std::endl;
+            std::cout << " as fast as possible" << std::endl;
         }
-        
-        // Sleep for 1 second between messages
-        if (i < message_count) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+        ReplayOptions replay_options;
+        replay_options.speed = replay_speed;
+        replay_options.ttl = message_ttl;
+        replay_options.send_timeout = send_timeout;
+        replay_options.lanes = router.size();
+        ReplayStats replayed = replayCapture(replay, publisher, replay_options);
+        std::cout << "[PRODUCER] Replayed " << replayed.messages << " messages (" << replayed.bytes
+                  << " body bytes), skipped " << replayed.skipped << " other frames, " << replayed.failed
+                  << " failed, max lag " << replayed.max_lag_ns / 1000 << " us" << std::endl;
+    } else {
+        std::cout << "[PRODUCER] Sending " << message_count << " messages to " << router.size()
+                  << " destination(s) from " << publisher_threads << " thread(s)";
+        if (target_rate > 0) {
+            std::cout << " at " << target_rate << " msg/s (open loop)";
         }
+        std::cout << std::endl;
+    }
+
+    // Thread t publishes messages t+1, t+1+N, ... keeping send_interval pacing
+    // per thread, or following the shared open-loop schedule
+    SendSchedule schedule(target_rate, realtimeNs());
+    std::vector<SendLatency> send_latency(publisher_threads);
+    auto publish_share = [&](int thread_index, CoreStats& stats) {
+        std::string greeting;
+        for (int i = thread_index + 1; i <= message_count; i += publisher_threads) {
+            std::string_view body = payloadFor(payloads, i, greeting);
+            uint64_t intended_ns = schedule.enabled() ? schedule.waitFor(i) : 0;
+
+            const LiveSettings& settings = live.read();
+            if (settings.log_level <= LogLevel::Info) {
+                std::ostringstream line;
+                line << "[PRODUCER] Sending message " << i << "/" << message_count << ": "
+                     << describePayload(payloads, body) << "\n";
+                std::cout << line.str() << std::flush;
+            }
+
+            size_t route = router.route(i, body);
+            SpanRecord span;
+            char traceparent_buffer[TraceContext::kHeaderLength];
+            std::string_view traceparent = startSendSpan(settings.trace_sample_ratio, span, traceparent_buffer);
+            uint64_t now_ns = realtimeNs();
+            PooledBuffer frame;
+            {
+                TRACE_SCOPE_ARG("encode", body.size());
+                frame = router.encodeSend(route, body, now_ns, expiresAt(now_ns, message_ttl), intended_ns,
+                                          traceparent);
+            }
+            SendResult result;
+            {
+                TRACE_SCOPE_ARG("enqueue", i);
+                result = publisher.send(frame, send_timeout, route);
+            }
+            if (!traceparent.empty()) {
+                finishSendSpan(spans, span, router.at(route).name, body.size(), result == SendResult::Ok);
+            }
+            if (schedule.enabled()) {
+                send_latency[thread_index].record(intended_ns, now_ns, realtimeNs());
+            }
+            if (result == SendResult::Ok) {
+                stats.record(body.size());
+            } else {
+                // Shed the message rather than queueing without bound
+                std::cerr << "[PRODUCER] Dropping message " << i << ": " << sendResultName(result) << std::endl;
+            }
+
+            if (!schedule.enabled() && i + publisher_threads <= message_count && settings.send_interval.count() > 0) {
+                std::this_thread::sleep_for(settings.send_interval);
+            }
+        }
+    };
+
+    if (replay_file.empty()) {
+        std::vector<std::thread> app_threads;
+        for (int t = 1; t < publisher_threads; ++t) {
+            app_threads.push_back(runtime.spawn("app-" + std::to_string(t),
+                                                [&, t](CoreStats& stats) { publish_share(t, stats); }));
+        }
+        publish_share(0, main_stats);
+        for (std::thread& thread : app_threads) {
+            thread.join();
+        }
+    }
+
+    admin.stop();
+    if (profiler) {
+        SamplingProfiler::instance().stop();
+    }
+    reload_signal.stop();
+    active_publisher.store(nullptr, std::memory_order_release);
+    publisher.stop();
+    PublisherStats publish_stats = publisher.stats();
+    std::cout << "[PRODUCER] Sent " << publish_stats.frames << " frames in " << publish_stats.batches
+              << " batches (" << publish_stats.failed << " failed)" << std::endl;
+    std::cout << "[PRODUCER] Backpressure: " << publish_stats.would_block << " would-block, "
+              << publish_stats.timed_out << " timed out, throttled for "
+              << publish_stats.throttled_ns / 1'000'000 << " ms, peak in-flight "
+              << publish_stats.peak_inflight_bytes << " bytes" << std::endl;
+    SendLatency all_send_latency;
+    for (const SendLatency& latency : send_latency) {
+        all_send_latency.merge(latency);
+    }
+    if (all_send_latency.corrected.count() > 0) {
+        all_send_latency.print(std::cout, "[PRODUCER]");
+    }
+    for (size_t route = 0; route < router.size(); ++route) {
+        LaneStats lane = publisher.laneStats(route);
+        std::cout << "[PRODUCER]   " << router.at(route).name << ": " << lane.frames << " frames, "
+                  << lane.bytes << " bytes" << std::endl;
+    }
+    if (publish_stats.failed > 0) {
+        std::cerr << "[PRODUCER] Failed to send " << publish_stats.failed << " messages" << std::endl;
     }
     
     std::cout << "[PRODUCER] All messages sent. Disconnecting..." << std::endl;
     client.disconnect();
+    finish_capture();
+    finish_trace();
+    finish_spans();
+
+    BufferPoolStats pool_stats = BufferPool::instance().stats();
+    std::cout << "[PRODUCER] Buffer pool hit rate: " << std::fixed << std::setprecision(1)
+              << pool_stats.hitRate() * 100.0 << "%, bytes outstanding: "
+              << pool_stats.bytes_outstanding << ", huge page slabs: " << pool_stats.huge_slab_bytes
+              << "/" << pool_stats.slab_bytes << " bytes" << std::endl;
     
+    main_stats.sampleScheduler();
+    runtime.report(std::cout, "[PRODUCER]");
+
     std::cout << "[PRODUCER] Producer application completed successfully" << std::endl;
     return 0;
 }
\ No newline at end of file
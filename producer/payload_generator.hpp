@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What the producer puts in message bodies.
+enum class PayloadContent {
+    Greeting,  // "Hello from C++ Producer - <id>", built per message
+    Random,    // printable text of the sampled size
+    Json,      // JSON object from a template, padded to the sampled size
+};
+
+inline const char* payloadContentName(PayloadContent content) {
+    switch (content) {
+        case PayloadContent::Random: return "random";
+        case PayloadContent::Json: return "json";
+        default: return "greeting";
+    }
+}
+
+inline bool parsePayloadContent(std::string_view text, PayloadContent& content) {
+    if (text == "greeting") {
+        content = PayloadContent::Greeting;
+    } else if (text == "random") {
+        content = PayloadContent::Random;
+    } else if (text == "json") {
+        content = PayloadContent::Json;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline std::string_view payloadContentType(PayloadContent content) {
+    return content == PayloadContent::Json ? "application/json" : "text/plain";
+}
+
+enum class SizeDistribution {
+    Fixed,      // always `size`
+    Uniform,    // [min_size, max_size]
+    Lognormal,  // median `size`, shape `sigma`, clamped to [min_size, max_size]
+    Empirical,  // sampled from a "size [weight]" table
+};
+
+inline const char* sizeDistributionName(SizeDistribution distribution) {
+    switch (distribution) {
+        case SizeDistribution::Uniform: return "uniform";
+        case SizeDistribution::Lognormal: return "lognormal";
+        case SizeDistribution::Empirical: return "empirical";
+        default: return "fixed";
+    }
+}
+
+inline bool parseSizeDistribution(std::string_view text, SizeDistribution& distribution) {
+    if (text == "fixed") {
+        distribution = SizeDistribution::Fixed;
+    } else if (text == "uniform") {
+        distribution = SizeDistribution::Uniform;
+    } else if (text == "lognormal") {
+        distribution = SizeDistribution::Lognormal;
+    } else if (text == "empirical") {
+        distribution = SizeDistribution::Empirical;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+struct PayloadOptions {
+    PayloadContent content = PayloadContent::Greeting;
+    SizeDistribution distribution = SizeDistribution::Fixed;
+    size_t size = 256;            // fixed size, lognormal median
+    size_t min_size = 16;
+    size_t max_size = 64 * 1024;
+    double sigma = 1.0;           // lognormal shape
+    std::string size_file;        // empirical table: one "size [weight]" per line, '#' comments
+    double compressibility = 0.5; // share of each 64-byte block that repeats, 0-1
+    uint64_t seed = 1;
+    size_t pool_size = 1024;      // distinct payloads, reused round-robin
+};
+
+// SplitMix64. Unlike the <random> distributions its output is specified, so
+// a seed reproduces the same payloads with any standard library.
+class PayloadRandom {
+public:
+    explicit PayloadRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    // [0, 1)
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+    // [low, high]
+    uint64_t between(uint64_t low, uint64_t high) { return low + next() % (high - low + 1); }
+
+    // Standard normal (Box-Muller).
+    double normal() {
+        double u1 = 1.0 - uniform();
+        double u2 = uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+
+private:
+    uint64_t state;
+};
+
+// Builds a pool of message bodies up front so a benchmark measures the
+// messaging path, not payload generation. Sizes follow the configured
+// distribution and text is a mix of a repeated phrase and random symbols,
+// with `compressibility` setting the repeated share.
+class PayloadGenerator {
+public:
+    bool init(const PayloadOptions& payload_options, std::string& error) {
+        options = payload_options;
+        pool.clear();
+        if (options.content == PayloadContent::Greeting) {
+            return true;
+        }
+        if (options.min_size > options.max_size) {
+            error = "payload-min-size is larger than payload-max-size";
+            return false;
+        }
+        if (options.distribution == SizeDistribution::Empirical && !loadSizeTable(error)) {
+            return false;
+        }
+        PayloadRandom random(options.seed);
+        pool.reserve(options.pool_size);
+        for (size_t i = 0; i < std::max<size_t>(options.pool_size, 1); ++i) {
+            size_t size = sampleSize(random);
+            pool.push_back(options.content == PayloadContent::Json ? makeJson(random, i, size)
+                                                                   : makeText(random, size));
+        }
+        return true;
+    }
+
+    // False for PayloadContent::Greeting, which the caller builds itself.
+    bool enabled() const { return !pool.empty(); }
+
+    std::string_view payload(uint64_t sequence) const { return pool[sequence % pool.size()]; }
+
+    size_t poolSize() const { return pool.size(); }
+
+    size_t poolBytes() const {
+        size_t total = 0;
+        for (const std::string& body : pool) {
+            total += body.size();
+        }
+        return total;
+    }
+
+    size_t minSize() const {
+        size_t smallest = SIZE_MAX;
+        for (const std::string& body : pool) {
+            smallest = std::min(smallest, body.size());
+        }
+        return pool.empty() ? 0 : smallest;
+    }
+
+    size_t maxSize() const {
+        size_t largest = 0;
+        for (const std::string& body : pool) {
+            largest = std::max(largest, body.size());
+        }
+        return largest;
+    }
+
+private:
+    static constexpr size_t kBlock = 64;
+    static constexpr std::string_view kPhrase =
+        "the quick brown fox jumps over the lazy dog while the market data keeps flowing ";
+    static constexpr std::string_view kSymbols =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    bool loadSizeTable(std::string& error) {
+        std::ifstream in(options.size_file);
+        if (!in) {
+            error = "cannot open payload size file '" + options.size_file + "'";
+            return false;
+        }
+        sizes.clear();
+        cumulative_weights.clear();
+        double total = 0;
+        std::string line;
+        for (int line_number = 1; std::getline(in, line); ++line_number) {
+            std::string_view text = std::string_view(line).substr(0, line.find('#'));
+            size_t start = text.find_first_not_of(" \t\r");
+            if (start == std::string_view::npos) {
+                continue;
+            }
+            text.remove_prefix(start);
+            size_t size = 0;
+            double weight = 1.0;
+            auto parsed = std::from_chars(text.data(), text.data() + text.size(), size);
+            std::string_view rest(parsed.ptr, text.data() + text.size() - parsed.ptr);
+            size_t weight_start = rest.find_first_not_of(" \t\r");
+            bool ok = parsed.ec == std::errc() &&
+                      (weight_start == std::string_view::npos ||
+                       std::from_chars(rest.data() + weight_start, rest.data() + rest.size(), weight).ec ==
+                           std::errc());
+            if (!ok || weight <= 0) {
+                error = options.size_file + ":" + std::to_string(line_number) + ": expected 'size [weight]'";
+                return false;
+            }
+            total += weight;
+            sizes.push_back(size);
+            cumulative_weights.push_back(total);
+        }
+        if (sizes.empty()) {
+            error = "payload size file '" + options.size_file + "' has no sizes";
+            return false;
+        }
+        return true;
+    }
+
+    size_t sampleSize(PayloadRandom& random) {
+        switch (options.distribution) {
+            case SizeDistribution::Uniform:
+                return static_cast<size_t>(random.between(options.min_size, options.max_size));
+            case SizeDistribution::Lognormal: {
+                double size = static_cast<double>(options.size) * std::exp(options.sigma * random.normal());
+                // Clamp before converting: the tail can be inf or beyond SIZE_MAX,
+                // where the cast is undefined; NaN fails the first test
+                if (!(size > static_cast<double>(options.min_size))) {
+                    return options.min_size;
+                }
+                if (size >= static_cast<double>(options.max_size)) {
+                    return options.max_size;
+                }
+                return static_cast<size_t>(size);
+            }
+            case SizeDistribution::Empirical: {
+                double point = random.uniform() * cumulative_weights.back();
+                size_t index = std::upper_bound(cumulative_weights.begin(), cumulative_weights.end(), point) -
+                               cumulative_weights.begin();
+                return sizes[std::min(index, sizes.size() - 1)];
+            }
+            default:
+                return options.size;
+        }
+    }
+
+    // Appends `length` bytes: in every 64-byte block the first
+    // compressibility * 64 bytes come from kPhrase, the rest are random.
+    void appendText(PayloadRandom& random, std::string& out, size_t length) {
+        size_t repeated = static_cast<size_t>(std::clamp(options.compressibility, 0.0, 1.0) * kBlock);
+        size_t phrase_pos = 0;
+        for (size_t i = 0; i < length; ++i) {
+            if (i % kBlock < repeated) {
+                out.push_back(kPhrase[phrase_pos++ % kPhrase.size()]);
+            } else {
+                out.push_back(kSymbols[random.next() % kSymbols.size()]);
+            }
+        }
+    }
+
+    std::string makeText(PayloadRandom& random, size_t size) {
+        std::string body;
+        body.reserve(size);
+        appendText(random, body, size);
+        return body;
+    }
+
+    // An order-like record; "note" pads it to `size` (bodies never shrink
+    // below the fixed fields).
+    std::string makeJson(PayloadRandom& random, size_t index, size_t size) {
+        static constexpr std::string_view kRegions[] = {"eu-west-1", "us-east-1", "ap-south-1", "sa-east-1"};
+        static constexpr std::string_view kStatuses[] = {"new", "open", "filled", "cancelled"};
+        uint64_t cents = random.between(100, 10'000'000);
+        std::string body;
+        body.reserve(size + 16);
+        body.append("{\"id\":").append(std::to_string(index));
+        body.append(",\"customer\":\"cust-").append(std::to_string(random.between(10000, 99999)));
+        body.append("\",\"region\":\"").append(kRegions[random.next() % std::size(kRegions)]);
+        body.append("\",\"amount\":").append(std::to_string(cents / 100)).append(".");
+        body.append(cents % 100 < 10 ? "0" : "").append(std::to_string(cents % 100));
+        body.append(",\"status\":\"").append(kStatuses[random.next() % std::size(kStatuses)]);
+        body.append("\",\"note\":\"");
+        constexpr size_t kClosing = 2;  // "}
+        if (body.size() + kClosing < size) {
+            appendText(random, body, size - body.size() - kClosing);
+        }
+        body.append("\"}");
+        return body;
+    }
+
+    PayloadOptions options;
+    std::vector<std::string> pool;
+    std::vector<size_t> sizes;               // empirical table
+    std::vector<double> cumulative_weights;  // running weight sum per entry
+};
@@ -0,0 +1,456 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <limits.h>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+#include "buffer_pool.hpp"
+#include "cpu_affinity.hpp"
+#include "latency.hpp"
+#include "live_config.hpp"
+#include "mpsc_queue.hpp"
+#include "spin_wait.hpp"
+#include "stomp_frame.hpp"
+
+// Where the sender thread writes batches of encoded frames.
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+    // Writes every byte of `count` frames; false on connection failure.
+    virtual bool writeFrames(const iovec* frames, int count) = 0;
+};
+
+// Outcome of handing a frame to the publisher.
+enum class SendResult {
+    Ok,          // queued; the sender thread owns the frame now
+    WouldBlock,  // in-flight limit reached (trySend only); caller keeps the frame
+    TimedOut,    // still over the limit when the timeout expired; caller keeps the frame
+    Closed,      // publisher stopped
+};
+
+inline const char* sendResultName(SendResult result) {
+    switch (result) {
+        case SendResult::Ok: return "ok";
+        case SendResult::WouldBlock: return "would-block";
+        case SendResult::TimedOut: return "timed-out";
+        default: return "closed";
+    }
+}
+
+struct PublisherOptions {
+    size_t queue_capacity = 4096;         // frames; rounded up to a power of two
+    // Backpressure: frames accepted but not yet written to the socket. Once
+    // either limit is hit, trySend() reports WouldBlock and send() waits.
+    size_t max_inflight_messages = 4096;
+    size_t max_inflight_bytes = 8 * 1024 * 1024;
+    size_t max_batch_frames = 64;         // frames per writev()
+    size_t max_batch_bytes = 256 * 1024;  // bytes per writev()
+    int idle_spins = 2000;                // polls before the sender goes to sleep
+    size_t lanes = 1;                     // per-destination queues (see Publisher)
+};
+
+struct PublisherStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t batches = 0;
+    uint64_t failed = 0;
+    uint64_t would_block = 0;        // trySend()/send() attempts that found the limit reached
+    uint64_t timed_out = 0;          // send() calls that gave up
+    uint64_t throttled_ns = 0;       // total time callers spent blocked in send()
+    uint64_t inflight_messages = 0;  // current
+    uint64_t inflight_bytes = 0;     // current
+    uint64_t peak_inflight_bytes = 0;
+};
+
+// Per-lane (per-destination) counters.
+struct LaneStats {
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+};
+
+// Thread-safe publishing over one connection. Any number of application
+// threads encode their frame locally and hand it to a lock-free MPSC queue;
+// a dedicated sender thread drains the queues and writes frames in batches
+// with one writev() per batch. The only lock is the sender's sleep/wake
+// handshake, which application threads touch only while the sender is idle
+// or while they are throttled.
+//
+// Frames are queued on one of `options.lanes` lanes, typically one per
+// destination. The sender drains lanes round-robin and keeps each lane's
+// frames contiguous inside a batch, so a writev() carries runs of frames
+// for the same destination rather than an arbitrary interleaving.
+//
+// In-flight messages/bytes are bounded so that a slow broker turns into
+// explicit backpressure (WouldBlock / TimedOut) instead of unbounded memory.
+class Publisher {
+public:
+    Publisher(FrameSink& sink, const PublisherOptions& options = PublisherOptions())
+        : sink(sink),
+          options(options),
+          batch_limits(clampBatchLimits(options.max_batch_frames, options.max_batch_bytes)) {
+        this->options.max_batch_frames = batch_limits.read().max_frames;
+        this->options.lanes = std::max<size_t>(options.lanes, 1);
+        for (size_t i = 0; i < this->options.lanes; ++i) {
+            lanes.push_back(std::make_unique<Lane>(std::max(options.queue_capacity, options.max_inflight_messages)));
+        }
+    }
+
+    ~Publisher() { stop(); }
+
+    Publisher(const Publisher&) = delete;
+    Publisher& operator=(const Publisher&) = delete;
+
+    void start(CoreRuntime& runtime) {
+        running.store(true, std::memory_order_release);
+        sender = runtime.spawn("sender", [this](CoreStats& stats) { run(stats); });
+    }
+
+    // Drains everything already queued, then joins the sender thread.
+    void stop() {
+        if (!sender.joinable()) {
+            return;
+        }
+        running.store(false, std::memory_order_seq_cst);
+        wake();
+        sender.join();
+        space_cv.notify_all();
+    }
+
+    // Changes max_batch_frames/max_batch_bytes while running; the sender
+    // picks the new limits up at its next batch.
+    void setBatchLimits(size_t max_frames, size_t max_bytes) {
+        batch_limits.publish(clampBatchLimits(max_frames, max_bytes));
+    }
+
+    // `expires_ms` is the absolute expiry (ms since the epoch), 0 for none.
+    static PooledBuffer encodeSend(std::string_view destination, std::string_view body, uint64_t sent_at_ns,
+                                   uint64_t expires_ms = 0) {
+        StompFrameBuilder builder("SEND", body.size() + destination.size() + 160);
+        builder.header("destination", destination)
+            .header("content-type", "text/plain")
+            .header("content-length", body.size())
+            .header("sent-at-ns", sent_at_ns);
+        if (expires_ms != 0) {
+            builder.header("expires", expires_ms);
+        }
+        return builder.finish(body);
+    }
+
+    // Non-blocking: queues the frame if it fits within the in-flight limits,
+    // otherwise returns WouldBlock and leaves `frame` with the caller so it
+    // can retry later or shed the message. Safe to call from any thread.
+    // `lane` must be below options.lanes.
+    SendResult trySend(PooledBuffer& frame, size_t lane = 0) {
+        if (!running.load(std::memory_order_acquire)) {
+            return SendResult::Closed;
+        }
+        if (!reserve(frame.size())) {
+            would_block.fetch_add(1, std::memory_order_relaxed);
+            return SendResult::WouldBlock;
+        }
+        return enqueue(frame, lane) ? SendResult::Ok : SendResult::Closed;
+    }
+
+    // Like trySend() but waits up to `timeout` for in-flight space to free
+    // up. Time spent waiting is accounted as throttled time.
+    SendResult send(PooledBuffer& frame, std::chrono::nanoseconds timeout, size_t lane = 0) {
+        SendResult result = trySend(frame, lane);
+        if (result != SendResult::WouldBlock) {
+            return result;
+        }
+
+        uint64_t start = monotonicNs();
+        uint64_t deadline = start + static_cast<uint64_t>(timeout.count());
+        for (int spins = 0; spins < 256; ++spins) {
+            cpuRelax();
+            if (reserve(frame.size())) {
+                return finishThrottled(frame, lane, start);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(space_mutex);
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        for (;;) {
+            if (!running.load(std::memory_order_acquire)) {
+                result = SendResult::Closed;
+                break;
+            }
+            if (reserve(frame.size())) {
+                result = SendResult::Ok;
+                break;
+            }
+            uint64_t now = monotonicNs();
+            if (now >= deadline) {
+                result = SendResult::TimedOut;
+                break;
+            }
+            space_cv.wait_for(lock, std::chrono::nanoseconds(std::min<uint64_t>(deadline - now, 10'000'000)));
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        lock.unlock();
+
+        if (result == SendResult::Ok) {
+            return finishThrottled(frame, lane, start);
+        }
+        throttled_ns.fetch_add(monotonicNs() - start, std::memory_order_relaxed);
+        if (result == SendResult::TimedOut) {
+            timed_out.fetch_add(1, std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    PublisherStats stats() const {
+        PublisherStats result;
+        result.frames = frames_sent.load(std::memory_order_relaxed);
+        result.bytes = bytes_sent.load(std::memory_order_relaxed);
+        result.batches = batches_sent.load(std::memory_order_relaxed);
+        result.failed = frames_failed.load(std::memory_order_relaxed);
+        result.would_block = would_block.load(std::memory_order_relaxed);
+        result.timed_out = timed_out.load(std::memory_order_relaxed);
+        result.throttled_ns = throttled_ns.load(std::memory_order_relaxed);
+        result.inflight_messages = inflight_messages.load(std::memory_order_relaxed);
+        result.inflight_bytes = inflight_bytes.load(std::memory_order_relaxed);
+        result.peak_inflight_bytes = peak_inflight_bytes.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    size_t laneCount() const { return lanes.size(); }
+
+    LaneStats laneStats(size_t lane) const {
+        LaneStats result;
+        result.frames = lanes[lane]->frames_sent.load(std::memory_order_relaxed);
+        result.bytes = lanes[lane]->bytes_sent.load(std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    struct Lane {
+        explicit Lane(size_t capacity) : queue(capacity) {}
+
+        MpscQueue<PooledBuffer> queue;
+        alignas(kCacheLineSize) std::atomic<uint64_t> frames_sent{0};  // sender thread only writes
+        std::atomic<uint64_t> bytes_sent{0};
+    };
+
+    // A contiguous run of frames from one lane inside the current batch.
+    struct LaneRun {
+        size_t lane;
+        size_t frames;
+        size_t bytes;
+    };
+
+    // Optimistically claims in-flight budget; an empty pipeline always admits
+    // one frame so oversized frames cannot deadlock.
+    bool reserve(size_t bytes) {
+        uint64_t messages = inflight_messages.fetch_add(1, std::memory_order_acq_rel);
+        uint64_t total = inflight_bytes.fetch_add(bytes, std::memory_order_acq_rel) + bytes;
+        if (messages > 0 && (messages >= options.max_inflight_messages || total > options.max_inflight_bytes)) {
+            release(1, bytes);
+            return false;
+        }
+        uint64_t peak = peak_inflight_bytes.load(std::memory_order_relaxed);
+        while (total > peak && !peak_inflight_bytes.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    void release(uint64_t messages, uint64_t bytes) {
+        inflight_messages.fetch_sub(messages, std::memory_order_acq_rel);
+        inflight_bytes.fetch_sub(bytes, std::memory_order_acq_rel);
+    }
+
+    SendResult finishThrottled(PooledBuffer& frame, size_t lane, uint64_t start) {
+        bool queued = enqueue(frame, lane);
+        throttled_ns.fetch_add(monotonicNs() - start, std::memory_order_relaxed);
+        return queued ? SendResult::Ok : SendResult::Closed;
+    }
+
+    // Each lane's queue holds at least max_inflight_messages slots, so a reserved
+    // frame only waits here for the sender to finish recycling a slot.
+    //
+    // Stop handshake: an enqueuer announces itself in `enqueuers` before
+    // checking `running`, and the sender only exits once `running` is false
+    // and no enqueuer is active. A frame is therefore either refused here
+    // (false; its reservation is returned and the caller keeps it) or
+    // drained before the sender exits, never stranded in a queue.
+    bool enqueue(PooledBuffer& frame, size_t lane) {
+        enqueuers.fetch_add(1, std::memory_order_seq_cst);
+        if (!running.load(std::memory_order_seq_cst)) {
+            enqueuers.fetch_sub(1, std::memory_order_seq_cst);
+            release(1, frame.size());
+            return false;
+        }
+        MpscQueue<PooledBuffer>& queue = lanes[lane]->queue;
+        while (!queue.tryPush(frame)) {
+            cpuRelax();
+        }
+        enqueuers.fetch_sub(1, std::memory_order_seq_cst);
+        // Pairs with the fence in run(): either we see the sender asleep or
+        // it sees our frame before waiting.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sender_sleeping.load(std::memory_order_relaxed)) {
+            wake();
+        }
+        return true;
+    }
+
+    // Called by the sender after a batch left the process (or failed).
+    void completeBatch(uint64_t messages, uint64_t bytes) {
+        release(messages, bytes);
+        if (waiters.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(space_mutex);
+            space_cv.notify_all();
+        }
+    }
+
+    void wake() {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        wake_cv.notify_one();
+    }
+
+    size_t queuedApprox() const {
+        size_t total = 0;
+        for (const std::unique_ptr<Lane>& lane : lanes) {
+            total += lane->queue.sizeApprox();
+        }
+        return total;
+    }
+
+    // Pops up to one batch worth of frames, draining each lane in turn
+    // starting after the lane served first last time; returns the number popped.
+    size_t collectBatch(std::vector<PooledBuffer>& batch, std::vector<iovec>& iov, std::vector<LaneRun>& runs) {
+        batch.clear();
+        iov.clear();
+        runs.clear();
+        size_t bytes = 0;
+        const BatchLimits& limits = batch_limits.read();
+        PooledBuffer frame;
+        for (size_t visited = 0; visited < lanes.size(); ++visited) {
+            size_t lane = (next_lane + visited) % lanes.size();
+            LaneRun run{lane, 0, 0};
+            while (batch.size() < limits.max_frames && bytes < limits.max_bytes &&
+                   lanes[lane]->queue.tryPop(frame)) {
+                bytes += frame.size();
+                ++run.frames;
+                run.bytes += frame.size();
+                iov.push_back(iovec{frame.data(), frame.size()});
+                batch.push_back(std::move(frame));
+            }
+            if (run.frames > 0) {
+                runs.push_back(run);
+            }
+            if (batch.size() >= limits.max_frames || bytes >= limits.max_bytes) {
+                break;
+            }
+        }
+        next_lane = (next_lane + 1) % lanes.size();
+        return batch.size();
+    }
+
+    void run(CoreStats& stats) {
+        std::vector<PooledBuffer> batch;
+        std::vector<iovec> iov;
+        std::vector<LaneRun> runs;
+        batch.reserve(options.max_batch_frames);
+        iov.reserve(options.max_batch_frames);
+        runs.reserve(lanes.size());
+
+        int idle = 0;
+        for (;;) {
+            if (collectBatch(batch, iov, runs) > 0) {
+                idle = 0;
+                size_t bytes = 0;
+                for (const iovec& v : iov) {
+                    bytes += v.iov_len;
+                }
+                if (sink.writeFrames(iov.data(), static_cast<int>(iov.size()))) {
+                    frames_sent.fetch_add(batch.size(), std::memory_order_relaxed);
+                    bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+                    batches_sent.fetch_add(1, std::memory_order_relaxed);
+                    for (const PooledBuffer& frame : batch) {
+                        stats.record(frame.size());
+                    }
+                    for (const LaneRun& run : runs) {
+                        lanes[run.lane]->frames_sent.fetch_add(run.frames, std::memory_order_relaxed);
+                        lanes[run.lane]->bytes_sent.fetch_add(run.bytes, std::memory_order_relaxed);
+                    }
+                } else {
+                    frames_failed.fetch_add(batch.size(), std::memory_order_relaxed);
+                }
+                completeBatch(batch.size(), bytes);
+                continue;
+            }
+
+            if (!running.load(std::memory_order_seq_cst)) {
+                // Exit only once no enqueue() is in progress (see enqueue())
+                if (enqueuers.load(std::memory_order_seq_cst) == 0 && queuedApprox() == 0) {
+                    break;
+                }
+                continue;
+            }
+            if (++idle < options.idle_spins) {
+                cpuRelax();
+                continue;
+            }
+
+            // Announce we are going to sleep, then re-check so a publisher that
+            // pushed just before seeing the flag cannot be missed.
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            sender_sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (queuedApprox() == 0 && running.load(std::memory_order_acquire)) {
+                wake_cv.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            sender_sleeping.store(false, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+
+    struct BatchLimits {
+        size_t max_frames;
+        size_t max_bytes;
+    };
+
+    // A zero limit would leave collectBatch() unable to take anything
+    static BatchLimits clampBatchLimits(size_t max_frames, size_t max_bytes) {
+        return BatchLimits{std::clamp<size_t>(max_frames, 1, IOV_MAX), std::max<size_t>(max_bytes, 1)};
+    }
+
+    FrameSink& sink;
+    PublisherOptions options;
+    RcuSnapshot<BatchLimits> batch_limits;
+    std::vector<std::unique_ptr<Lane>> lanes;
+    size_t next_lane = 0;  // sender thread only
+    std::thread sender;
+    std::atomic<bool> running{false};
+    std::atomic<int> enqueuers{0};  // threads inside enqueue()
+
+    alignas(kCacheLineSize) std::atomic<bool> sender_sleeping{false};
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+
+    alignas(kCacheLineSize) std::atomic<uint64_t> inflight_messages{0};
+    std::atomic<uint64_t> inflight_bytes{0};
+    std::atomic<uint64_t> peak_inflight_bytes{0};
+    std::atomic<int> waiters{0};
+    std::mutex space_mutex;
+    std::condition_variable space_cv;
+
+    alignas(kCacheLineSize) std::atomic<uint64_t> frames_sent{0};
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<uint64_t> batches_sent{0};
+    std::atomic<uint64_t> frames_failed{0};
+    std::atomic<uint64_t> would_block{0};
+    std::atomic<uint64_t> timed_out{0};
+    std::atomic<uint64_t> throttled_ns{0};
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "expiration.hpp"
+#include "frame_capture.hpp"
+#include "latency.hpp"
+#include "publisher.hpp"
+#include "stomp_frame.hpp"
+
+struct ReplayOptions {
+    double speed = 1.0;  // 1 = original pacing, 2 = twice as fast, 0 = as fast as possible
+    std::chrono::milliseconds ttl{0};  // fresh `expires` on each message, 0 for none
+    std::chrono::milliseconds send_timeout{5000};
+    size_t lanes = 1;  // publisher lanes; each destination sticks to one
+};
+
+struct ReplayStats {
+    uint64_t messages = 0;  // frames handed to the publisher
+    uint64_t skipped = 0;   // records that are not messages (CONNECT, ACK, ...)
+    uint64_t failed = 0;    // malformed records and sends that did not go out
+    uint64_t bytes = 0;     // body bytes replayed
+    uint64_t max_lag_ns = 0;  // worst delay behind the captured schedule
+};
+
+// Headers the broker or the original sender set per delivery; replaying them
+// would be wrong (ids, acks) or stale (timestamps, expiry).
+inline bool isPerDeliveryHeader(std::string_view name) {
+    return name == "message-id" || name == "subscription" || name == "ack" || name == "redelivered" ||
+           name == "timestamp" || name == "receipt" || name == "content-length" || name == "sent-at-ns" ||
+           name == "expires" || name == "intended-at-ns" || name == "traceparent";
+}
+
+// Rebuilds a captured SEND (producer capture) or MESSAGE (consumer capture)
+// as a SEND with the same destination, application headers and body.
+inline PooledBuffer encodeReplay(const StompFrameView& frame, uint64_t sent_at_ns, uint64_t expires_ms) {
+    StompFrameBuilder builder("SEND", frame.body.size() + 256);
+    for (size_t i = 0; i < frame.headerCount(); ++i) {
+        const StompHeader& header = frame.headerAt(i);
+        if (!isPerDeliveryHeader(header.name)) {
+            builder.header(header.name, header.value);
+        }
+    }
+    builder.header("content-length", frame.body.size()).header("sent-at-ns", sent_at_ns);
+    if (expires_ms != 0) {
+        builder.header("expires", expires_ms);
+    }
+    return builder.finish(frame.body);
+}
+
+// Re-sends the messages in a capture through `publisher`: SEND frames the
+// capture wrote and MESSAGE frames it read. Each one goes out at its
+// captured offset divided by `speed`; a send that falls behind is not
+// skipped, so max_lag_ns shows whether the pace was sustained.
+inline ReplayStats replayCapture(CaptureReader& reader, Publisher& publisher, const ReplayOptions& options) {
+    ReplayStats stats;
+    std::map<std::string, size_t, std::less<>> destination_lanes;
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t first_offset_ns = 0;
+    bool first = true;
+
+    CaptureRecord record;
+    StompFrameView frame;
+    while (reader.next(record)) {
+        std::string_view wanted = record.direction == CaptureDirection::Sent ? "SEND" : "MESSAGE";
+        if (parseStompFrame(record.frame.data(), record.frame.size(), frame).status != ParseStatus::Complete) {
+            ++stats.failed;
+            continue;
+        }
+        if (frame.command != wanted) {
+            ++stats.skipped;
+            continue;
+        }
+
+        if (first) {
+            first_offset_ns = record.offset_ns;
+            first = false;
+        }
+        if (options.speed > 0) {
+            auto due = start + std::chrono::nanoseconds(static_cast<int64_t>(
+                                   static_cast<double>(record.offset_ns - first_offset_ns) / options.speed));
+            auto now = std::chrono::steady_clock::now();
+            if (now < due) {
+                std::this_thread::sleep_until(due);
+            } else {
+                stats.max_lag_ns = std::max<uint64_t>(
+                    stats.max_lag_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count());
+            }
+        }
+
+        std::string_view destination = frame.header("destination");
+        auto lane = destination_lanes.find(destination);
+        if (lane == destination_lanes.end()) {
+            size_t index = destination_lanes.size() % options.lanes;
+            lane = destination_lanes.emplace(std::string(destination), index).first;
+        }
+        uint64_t now_ns = realtimeNs();
+        PooledBuffer out = encodeReplay(frame, now_ns, expiresAt(now_ns, options.ttl));
+        if (publisher.send(out, options.send_timeout, lane->second) == SendResult::Ok) {
+            ++stats.messages;
+            stats.bytes += frame.body.size();
+        } else {
+            ++stats.failed;
+        }
+    }
+    return stats;
+}